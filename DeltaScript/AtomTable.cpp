@@ -0,0 +1,25 @@
+#include <DeltaScript/DeltaScript.h>
+
+namespace DeltaScript {
+    int AtomTable::intern(std::string_view name) {
+        auto it = ids_.find(name);
+
+        if (it != ids_.end())
+            return it->second;
+
+        int id = (int)atoms_.size();
+
+        atoms_.push_back(Atom{ std::string(name), Util::hash_name(name) });
+        ids_[atoms_.back().name] = id;
+
+        return id;
+    }
+
+    const Atom& AtomTable::get(int id) const {
+        return atoms_[id];
+    }
+
+    size_t AtomTable::size() const {
+        return atoms_.size();
+    }
+}  // namespace DeltaScript
@@ -0,0 +1,479 @@
+#include <DeltaScript/DeltaScript.h>
+#include <cstring>
+
+namespace DeltaScript {
+    namespace {
+        const unsigned int max_operand = 0xFFFFFF;
+    }
+
+    Chunk::~Chunk() {
+        for (VariableReference* constant : constants)
+            delete constant;
+    }
+
+    unsigned int Chunk::add_constant(Variable* value) {
+        value->set_constant();
+
+        VariableReference* constant = new VariableReference(value);
+        constant->owner = true;
+
+        constants.push_back(constant);
+
+        return (unsigned int)constants.size() - 1;
+    }
+
+    const Chunk* Chunk::get_compiled() const {
+        if (!lazy_source)
+            return this;
+
+        // A failed compilation leaves the flag unset, the next call reports the error again
+        std::call_once(compile_once_, [this]() {
+            // Names only need to match by value, so the body gets a table of its own and
+            // chunks shared between threads never write to the same one
+            std::shared_ptr<AtomTable> body_atoms = std::make_shared<AtomTable>();
+            Lexer lex(lazy_source, lazy_begin, lazy_end, body_atoms.get());
+            Parser parser(&lex);
+
+            std::shared_ptr<Chunk> body = Compiler::compile(parser.parse_block().get(), body_atoms, lazy_source);
+            body->name = name;
+            body->parameters = parameters;
+
+            compiled_ = body;
+            });
+
+        return compiled_.get();
+    }
+
+    std::string Chunk::get_source() const {
+        if (!lazy_source)
+            return source;
+
+        return std::string(lazy_source->data() + lazy_begin, lazy_end - lazy_begin);
+    }
+
+    const JitCode* Chunk::get_jit_code() const {
+        std::call_once(jit_once_, [this]() {
+            jit_code_ = JitCode::compile(*this);
+            });
+
+        return jit_code_.get();
+    }
+
+    std::atomic<unsigned char>* Chunk::get_type_feedback() const {
+        std::call_once(type_feedback_once_, [this]() {
+            type_feedback_.reset(new std::atomic<unsigned char>[code.size()]());
+            });
+
+        return type_feedback_.get();
+    }
+
+    PropertyCache* const* Chunk::acquire_property_caches(const Context* context) const {
+        std::call_once(property_caches_once_, [this]() {
+            size_t count = 0;
+
+            for (unsigned int instruction : code) {
+                OpCode op = (OpCode)(instruction & 0xFF);
+
+                if (op == OpCode::GET_PROPERTY || op == OpCode::GET_INDEX)
+                    ++count;
+            }
+
+            property_caches_.reset(new PropertyCache*[code.size()]());
+            property_cache_entries_.reset(new PropertyCache[count]());
+
+            PropertyCache* cache = property_cache_entries_.get();
+
+            for (size_t i = 0; i < code.size(); ++i) {
+                OpCode op = (OpCode)(code[i] & 0xFF);
+
+                if (op == OpCode::GET_PROPERTY || op == OpCode::GET_INDEX)
+                    property_caches_[i] = cache++;
+            }
+            });
+
+        // A context only runs on one thread at a time, so nested runs of the owner share them
+        const Context* owner = nullptr;
+
+        if (!property_caches_owner_.compare_exchange_strong(owner, context, std::memory_order_acquire) && owner != context)
+            return nullptr;
+
+        ++property_caches_users_;
+
+        return property_caches_.get();
+    }
+
+    void Chunk::release_property_caches(const Context* context) const {
+        if (property_caches_owner_.load(std::memory_order_relaxed) == context && --property_caches_users_ == 0)
+            property_caches_owner_.store(nullptr, std::memory_order_release);
+    }
+
+    Compiler::Compiler(Chunk* chunk, std::shared_ptr<const AtomTable> atom_table, std::shared_ptr<const Source> source)
+        : chunk_(chunk), atom_table_(std::move(atom_table)), source_(std::move(source)), depth_(0) {
+        chunk_->atom_table = atom_table_;
+    }
+
+    std::shared_ptr<Chunk> Compiler::compile(const Node* block, std::shared_ptr<const AtomTable> atom_table, std::shared_ptr<const Source> source) {
+        std::shared_ptr<Chunk> chunk(new Chunk());
+        Compiler compiler(chunk.get(), std::move(atom_table), std::move(source));
+
+        for (auto& statement : block->children)
+            compiler.compile_statement(statement.get());
+
+        compiler.emit(OpCode::END);
+
+        return chunk;
+    }
+
+    std::shared_ptr<Chunk> Compiler::compile_function(const Node* definition) {
+        std::shared_ptr<Chunk> function;
+
+        if (definition->children.empty()) {
+            function.reset(new Chunk());
+            function->atom_table = atom_table_;
+            function->lazy_source = source_;
+            function->lazy_begin = (size_t)definition->integer;
+            function->lazy_end = (size_t)definition->end_position;
+        }
+        else {
+            function = compile(definition->children[0].get(), atom_table_, source_);
+            function->source = definition->string;
+        }
+
+        function->name = definition->atom;
+        function->parameters = definition->atoms;
+
+        return function;
+    }
+
+    void Compiler::compile_statement(const Node* node) {
+        switch (node->kind) {
+        case NodeKind::EXPRESSION:
+            compile_expression(node->children[0].get());
+            emit(OpCode::POP);
+            break;
+
+        case NodeKind::BLOCK:
+            for (auto& statement : node->children)
+                compile_statement(statement.get());
+            break;
+
+        case NodeKind::VAR:
+            for (auto& declaration : node->children) {
+                emit(OpCode::DECLARE, add_atom(declaration->atoms[0]));
+
+                for (size_t i = 1; i < declaration->atoms.size(); ++i)
+                    emit(OpCode::DECLARE_PROPERTY, add_atom(declaration->atoms[i]));
+
+                if (!declaration->children.empty()) {
+                    compile_expression(declaration->children[0].get());
+                    emit(OpCode::INITIALIZE);
+                }
+
+                emit(OpCode::POP);
+            }
+            break;
+
+        case NodeKind::IF: {
+            compile_expression(node->children[0].get());
+            size_t jump_to_else = emit(OpCode::JUMP_IF_FALSE);
+
+            compile_statement(node->children[1].get());
+
+            if (node->children.size() > 2) {
+                size_t jump_to_end = emit(OpCode::JUMP);
+                patch(jump_to_else, chunk_->code.size());
+
+                compile_statement(node->children[2].get());
+                patch(jump_to_end, chunk_->code.size());
+            }
+            else {
+                patch(jump_to_else, chunk_->code.size());
+            }
+            break;
+        }
+
+        case NodeKind::WHILE: {
+            size_t condition = chunk_->code.size();
+
+            compile_expression(node->children[0].get());
+            size_t jump_to_end = emit(OpCode::JUMP_IF_FALSE);
+
+            loops_.emplace_back();
+            compile_statement(node->children[1].get());
+            emit(OpCode::JUMP, (unsigned int)condition);
+
+            patch(jump_to_end, chunk_->code.size());
+            patch_loop_jumps(condition, chunk_->code.size());
+            break;
+        }
+
+        case NodeKind::FOR: {
+            compile_statement(node->children[0].get());
+
+            size_t condition = chunk_->code.size();
+
+            compile_expression(node->children[1].get());
+            size_t jump_to_end = emit(OpCode::JUMP_IF_FALSE);
+
+            loops_.emplace_back();
+            compile_statement(node->children[3].get());
+
+            size_t iterator = chunk_->code.size();
+
+            compile_expression(node->children[2].get());
+            emit(OpCode::POP);
+            emit(OpCode::JUMP, (unsigned int)condition);
+
+            patch(jump_to_end, chunk_->code.size());
+            patch_loop_jumps(iterator, chunk_->code.size());
+            break;
+        }
+
+        case NodeKind::RETURN:
+            if (!node->children.empty()) {
+                compile_expression(node->children[0].get());
+                emit(OpCode::RETURN, 1);
+            }
+            else {
+                emit(OpCode::RETURN, 0);
+            }
+            break;
+
+        // Statements leave the stack as they found it, so jumping between them needs no cleanup
+        case NodeKind::BREAK:
+            loops_.back().breaks.push_back(emit(OpCode::JUMP));
+            break;
+
+        case NodeKind::CONTINUE:
+            loops_.back().continues.push_back(emit(OpCode::JUMP));
+            break;
+
+        case NodeKind::FUNCTION_DECLARATION:
+            // Declared like a variable so that the name gets its frame slot updated
+            emit(OpCode::DECLARE, add_atom(node->atom));
+
+            chunk_->functions.push_back(compile_function(node));
+            emit(OpCode::PUSH_FUNCTION, (unsigned int)chunk_->functions.size() - 1);
+
+            emit(OpCode::INITIALIZE);
+            emit(OpCode::POP);
+            break;
+
+        default:
+            break;
+        }
+    }
+
+    void Compiler::compile_expression(const Node* node) {
+        switch (node->kind) {
+        case NodeKind::UNDEFINED:
+            emit(OpCode::PUSH_UNDEFINED);
+            break;
+
+        case NodeKind::NULL_:
+            emit(OpCode::PUSH_NULL);
+            break;
+
+        case NodeKind::INTEGER: {
+            auto it = integer_indices_.find(node->integer);
+
+            if (it == integer_indices_.end())
+                it = integer_indices_.emplace(node->integer, chunk_->add_constant(new Variable(node->integer))).first;
+
+            emit(OpCode::PUSH_CONSTANT, it->second);
+            break;
+        }
+
+        case NodeKind::FLOAT: {
+            // Keyed by the bits so that 0.0 and -0.0 stay apart
+            unsigned long long bits;
+            memcpy(&bits, &node->number, sizeof(bits));
+
+            auto it = float_indices_.find(bits);
+
+            if (it == float_indices_.end())
+                it = float_indices_.emplace(bits, chunk_->add_constant(new Variable(node->number))).first;
+
+            emit(OpCode::PUSH_CONSTANT, it->second);
+            break;
+        }
+
+        case NodeKind::STRING: {
+            auto it = string_indices_.find(node->string);
+
+            if (it == string_indices_.end())
+                it = string_indices_.emplace(node->string, chunk_->add_constant(new Variable(node->string, Variable::VariableFlags::STRING))).first;
+
+            emit(OpCode::PUSH_CONSTANT, it->second);
+            break;
+        }
+
+        case NodeKind::IDENTIFIER:
+            emit(OpCode::LOAD, add_atom(node->atom));
+            break;
+
+        case NodeKind::FUNCTION:
+            chunk_->functions.push_back(compile_function(node));
+            emit(OpCode::PUSH_FUNCTION, (unsigned int)chunk_->functions.size() - 1);
+            break;
+
+        case NodeKind::PROPERTY:
+            compile_expression(node->children[0].get());
+            emit(OpCode::GET_PROPERTY, add_atom(node->atom));
+            break;
+
+        case NodeKind::INDEX:
+            compile_expression(node->children[0].get());
+            compile_expression(node->children[1].get());
+            emit(OpCode::GET_INDEX);
+            break;
+
+        case NodeKind::CALL:
+            for (auto& child : node->children)
+                compile_expression(child.get());
+
+            emit(OpCode::CALL, (unsigned int)node->children.size() - 1);
+            break;
+
+        case NodeKind::NOT:
+            compile_expression(node->children[0].get());
+            emit(OpCode::NOT);
+            break;
+
+        case NodeKind::NEGATE:
+            compile_expression(node->children[0].get());
+            emit(OpCode::NEGATE);
+            break;
+
+        case NodeKind::POSTFIX:
+            compile_expression(node->children[0].get());
+            emit(OpCode::POSTFIX, (unsigned int)node->operation);
+            break;
+
+        case NodeKind::BINARY:
+            compile_expression(node->children[0].get());
+            compile_expression(node->children[1].get());
+            emit(OpCode::BINARY, (unsigned int)node->operation);
+            break;
+
+        case NodeKind::SHIFT:
+            compile_expression(node->children[0].get());
+            compile_expression(node->children[1].get());
+            emit(OpCode::SHIFT, (unsigned int)node->operation);
+            break;
+
+        case NodeKind::LOGIC:
+            compile_expression(node->children[0].get());
+
+            if (node->operation == TokenKind::AND_P || node->operation == TokenKind::OR_P) {
+                bool is_and = node->operation == TokenKind::AND_P;
+                size_t jump_to_end = emit(is_and ? OpCode::JUMP_IF_FALSE_KEEP : OpCode::JUMP_IF_TRUE_KEEP);
+
+                compile_expression(node->children[1].get());
+                emit(OpCode::BOOLEAN, (unsigned int)(is_and ? TokenKind::BIT_AND_P : TokenKind::BIT_OR_P));
+
+                patch(jump_to_end, chunk_->code.size());
+            }
+            else {
+                compile_expression(node->children[1].get());
+                emit(OpCode::BINARY, (unsigned int)node->operation);
+            }
+            break;
+
+        case NodeKind::TERNARY: {
+            compile_expression(node->children[0].get());
+            size_t jump_to_else = emit(OpCode::JUMP_IF_FALSE);
+
+            compile_expression(node->children[1].get());
+            size_t jump_to_end = emit(OpCode::JUMP);
+
+            // Only one of the branches leaves its value on the stack
+            --depth_;
+
+            patch(jump_to_else, chunk_->code.size());
+            compile_expression(node->children[2].get());
+
+            patch(jump_to_end, chunk_->code.size());
+            break;
+        }
+
+        case NodeKind::ASSIGN:
+            compile_expression(node->children[0].get());
+            emit(OpCode::PREPARE_ASSIGN);
+
+            compile_expression(node->children[1].get());
+            emit(OpCode::ASSIGN, (unsigned int)node->operation);
+            break;
+
+        default:
+            throw DeltaScriptException("Unexpected statement in expression");
+        }
+    }
+
+    size_t Compiler::emit(OpCode op, unsigned int operand) {
+        if (operand > max_operand)
+            throw DeltaScriptException("Script is too large to compile");
+
+        switch (op) {
+        case OpCode::PUSH_UNDEFINED:
+        case OpCode::PUSH_NULL:
+        case OpCode::PUSH_CONSTANT:
+        case OpCode::PUSH_FUNCTION:
+        case OpCode::LOAD:
+        case OpCode::DECLARE:
+            ++depth_;
+            break;
+        case OpCode::GET_INDEX:
+        case OpCode::BINARY:
+        case OpCode::SHIFT:
+        case OpCode::BOOLEAN:
+        case OpCode::JUMP_IF_FALSE:
+        case OpCode::ASSIGN:
+        case OpCode::POP:
+        case OpCode::INITIALIZE:
+            --depth_;
+            break;
+        case OpCode::CALL:
+        case OpCode::RETURN:
+            depth_ -= operand;
+            break;
+        default:
+            break;
+        }
+
+        if (depth_ > chunk_->stack_size)
+            chunk_->stack_size = depth_;
+
+        chunk_->code.push_back((unsigned int)op | (operand << 8));
+
+        return chunk_->code.size() - 1;
+    }
+
+    void Compiler::patch(size_t instruction, size_t target) {
+        if (target > max_operand)
+            throw DeltaScriptException("Script is too large to compile");
+
+        chunk_->code[instruction] = (chunk_->code[instruction] & 0xFF) | ((unsigned int)target << 8);
+    }
+
+    void Compiler::patch_loop_jumps(size_t continue_target, size_t break_target) {
+        for (size_t instruction : loops_.back().continues)
+            patch(instruction, continue_target);
+
+        for (size_t instruction : loops_.back().breaks)
+            patch(instruction, break_target);
+
+        loops_.pop_back();
+    }
+
+    unsigned int Compiler::add_atom(const Atom* atom) {
+        auto it = atom_indices_.find(atom);
+
+        if (it != atom_indices_.end())
+            return it->second;
+
+        chunk_->atoms.push_back(atom);
+
+        return atom_indices_[atom] = (unsigned int)chunk_->atoms.size() - 1;
+    }
+}  // namespace DeltaScript
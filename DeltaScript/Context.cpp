@@ -1,9 +1,68 @@
 #include <DeltaScript/DeltaScript.h>
 #include <sstream>
 
+#if defined(__GNUC__) || defined(__clang__)
+#define DELTASCRIPT_THREADED_DISPATCH
+#endif
+
 namespace DeltaScript {
+    namespace {
+        // Value to bind to a name, constants are copied so the pool never gets aliased
+        Variable* get_bindable_value(Variable* value) {
+            return value->is_constant() ? value->deep_copy() : value;
+        }
+
+        // Swaps a constant on the stack for a temporary copy before it gets modified in place
+        void unshare_constant(VariableReference*& ref) {
+            if (ref->var->is_constant())
+                ref = new VariableReference(ref->var->deep_copy());
+        }
+
+        // Operand types an instruction has seen, a site only ever moves from UNSEEN to one
+        // pair and from there to GENERIC
+        enum TypeFeedback : unsigned char {
+            UNSEEN,
+            INTEGERS,
+            DOUBLES,
+            STRINGS,
+            GENERIC,
+        };
+
+        // Holds the inline caches of a chunk for one run, see Chunk::acquire_property_caches,
+        // holds none for a nullptr chunk
+        class PropertyCacheLease {
+        private:
+            const Chunk* chunk_;
+            const Context* context_;
+            PropertyCache* const* caches_;
+
+        public:
+            PropertyCacheLease(const Chunk* chunk, const Context* context)
+                : chunk_(chunk), context_(context), caches_(chunk ? chunk->acquire_property_caches(context) : nullptr) {
+
+            }
+
+            PropertyCacheLease(const PropertyCacheLease&) = delete;
+            PropertyCacheLease& operator=(const PropertyCacheLease&) = delete;
+
+            ~PropertyCacheLease() {
+                if (caches_)
+                    chunk_->release_property_caches(context_);
+            }
+
+            PropertyCache* const* get() const {
+                return caches_;
+            }
+        };
+    }
+
     Context::Context() {
-        lex_ = nullptr;
+        atoms_ = std::make_shared<AtomTable>();
+        stack_top_ = 0;
+        stack_.resize(1024);
+        jit_enabled_ = true;
+        jit_threshold_ = 1000;
+        specialization_enabled_ = true;
         root_ = (new Variable("", Variable::VariableFlags::OBJECT))->inc_ref();
 
         add_native_function("function JSON.stringify(value)", [](Variable* var, void* data) {
@@ -24,43 +83,78 @@ namespace DeltaScript {
     }
 
     void Context::execute(const std::string& script) {
-        Lexer* old_lex = lex_;
+        execute(Source::from_string(script));
+    }
+
+    void Context::execute_file(const std::string& path) {
+        execute(Source::from_file(path));
+    }
+
+    void Context::execute(std::shared_ptr<const Source> source) {
+        execute_program(compile_source(std::move(source), atoms_).get());
+    }
+
+    void Context::execute(const Script& script) {
+        execute_program(script.get_program().get());
+    }
+
+    Script Context::compile(const std::string& script) const {
+        return compile(Source::from_string(script));
+    }
+
+    Script Context::compile(std::shared_ptr<const Source> source) const {
+        // A table of its own keeps the script independent from this context
+        std::shared_ptr<const Chunk> program = compile_source(source, std::make_shared<AtomTable>());
+
+        return Script(std::move(source), std::move(program));
+    }
+
+    size_t Context::check_syntax(const std::string& script) {
+        Lexer lex(script, atoms_.get());
+        Parser parser(&lex, false);
+
+        return parser.parse_program()->children.size();
+    }
+
+    std::shared_ptr<const Chunk> Context::compile_source(std::shared_ptr<const Source> source, std::shared_ptr<AtomTable> atoms) {
+        Lexer lex(source, atoms.get());
+        Parser parser(&lex);
+
+        return Compiler::compile(parser.parse_program().get(), std::move(atoms), std::move(source));
+    }
+
+    void Context::execute_program(const Chunk* program) {
         std::vector<Variable*> old_scopes = scopes_;
         scopes_.clear();
         scopes_.push_back(root_);
 
-        lex_ = new Lexer(script);
+        size_t old_stack_top = stack_top_;
 
         try {
-            bool can_execute = true;
-            while (lex_->get_current_token() != TokenKind::EOS)
-                process_statement(can_execute);
+            run(program);
         }
         catch (const DeltaScriptException & e) {
             // TODO: Add call stack details
 
-            delete lex_;
-            lex_ = old_lex;
+            stack_top_ = old_stack_top;
 
             throw e;
         }
 
-        delete lex_;
-        lex_ = old_lex;
         scopes_ = old_scopes;
     }
 
     void Context::add_native_function(const std::string& function_definition, NativeCallback callback, void* data) {
-        Lexer* old_lex = lex_;
-        lex_ = new Lexer(function_definition);
+        Lexer lex(function_definition, atoms_.get());
+        Parser parser(&lex);
         Variable* function_base = root_;
 
-        lex_->expect_and_get_next(TokenKind::FUNCTION_K);
-        std::string function_name = lex_->get_token_value();
-        lex_->expect_and_get_next(TokenKind::IDENTIFIER);
+        lex.expect_and_get_next(TokenKind::FUNCTION_K);
+        std::string function_name = lex.get_token_value();
+        lex.expect_and_get_next(TokenKind::IDENTIFIER);
 
-        while (lex_->c_token_kind == TokenKind::PERIOD_P) {
-            lex_->parse_next_token();
+        while (lex.c_token_kind == TokenKind::PERIOD_P) {
+            lex.parse_next_token();
 
             VariableReference* ref = function_base->find_child(function_name);
 
@@ -68,821 +162,771 @@ namespace DeltaScript {
                 ref = function_base->add_child(function_name, new Variable("", Variable::VariableFlags::OBJECT));
 
             function_base = ref->var;
-            function_name = lex_->get_token_value();
+            function_name = lex.get_token_value();
 
-            lex_->expect_and_get_next(TokenKind::IDENTIFIER);
+            lex.expect_and_get_next(TokenKind::IDENTIFIER);
         }
 
         Variable* function_var = new Variable("", Variable::VariableFlags::FUNCTION | Variable::VariableFlags::NATIVE);
         function_var->set_native_callback(callback, data);
-        parse_function_arguments(function_var);
 
-        delete lex_;
-        lex_ = old_lex;
+        for (const Atom* argument : parser.parse_function_arguments())
+            function_var->add_child(*argument);
 
         function_base->add_child(function_name, function_var);
     }
 
-    VariableReference* Context::process_function_call(bool& can_execute, VariableReference* function, Variable* parent) {
-        if (can_execute) {
-            if (!function->var->is_function()) {
-                std::stringstream msg;
-                msg << "Expecting '" << function->name << "' to be a function";
+    void Context::run(const Chunk* chunk) {
+        // The frame starts with one slot per atom of the chunk, followed by the operands. Scoping
+        // is dynamic, so what a name refers to is only known once the chunk runs: the first
+        // lookup of a name stores the variable in its slot and later loads skip the scope walk.
+        // Slots stay valid for the whole run, as variables are only ever added to the innermost
+        // scope, which is the one DECLARE updates the slot for.
+        size_t base = stack_top_;
+        size_t slot_count = chunk->atoms.size();
 
-                throw DeltaScriptException(msg.str());
-            }
-
-            lex_->expect_and_get_next(TokenKind::LPAREN_P);
+        if (stack_.size() < base + slot_count + chunk->stack_size)
+            stack_.resize(base + slot_count + chunk->stack_size);
 
-            Variable* function_root = new Variable("", Variable::VariableFlags::FUNCTION);
+        StackValue* slots = stack_.data() + base;
 
-            if (parent)
-                function_root->add_child("this", parent);
+        for (size_t i = 0; i < slot_count; ++i)
+            slots[i].ref = nullptr;
 
-            VariableReference* v = function->var->first_child_;
+        StackValue* sp = slots + slot_count;
+        const unsigned int* code = chunk->code.data();
+        const unsigned int* ip = code;
+        std::atomic<unsigned char>* feedback;
+        std::unique_ptr<std::atomic<unsigned char>[]> generic_feedback;
 
-            while (v) {
-                VariableReference* value = process_base(can_execute);
-
-                if (can_execute) {
-                    if (value->var->is_basic()) {
-                        function_root->add_child(v->name, value->var->deep_copy());
-                    }
-                    else {
-                        function_root->add_child(v->name, value->var);
-                    }
-                }
-
-                CLEAN_VAR_REFERENCE(value);
-
-                if (lex_->c_token_kind != TokenKind::RPAREN_P)
-                    lex_->expect_and_get_next(TokenKind::COMMA_P);
+        // Without specialization every site has already seen everything
+        if (specialization_enabled_) {
+            feedback = chunk->get_type_feedback();
+        }
+        else {
+            generic_feedback.reset(new std::atomic<unsigned char>[chunk->code.size()]);
 
-                v = v->next_sibling;
-            }
+            for (size_t i = 0; i < chunk->code.size(); ++i)
+                generic_feedback[i].store(TypeFeedback::GENERIC, std::memory_order_relaxed);
 
-            lex_->expect_and_get_next(TokenKind::RPAREN_P);
+            feedback = generic_feedback.get();
+        }
 
-            VariableReference* return_var = nullptr;
-            VariableReference* return_var_ref = function_root->add_child("return");
+        PropertyCacheLease property_cache_lease(specialization_enabled_ ? chunk : nullptr, this);
+        PropertyCache* const* property_caches = property_cache_lease.get();
+        unsigned int operand;
 
-            scopes_.push_back(function_root);
+#ifdef DELTASCRIPT_THREADED_DISPATCH
+        static void* const dispatch_table[] = {
+            &&op_PUSH_UNDEFINED, &&op_PUSH_NULL, &&op_PUSH_CONSTANT, &&op_PUSH_FUNCTION, &&op_LOAD,
+            &&op_GET_PROPERTY, &&op_GET_INDEX, &&op_CALL, &&op_NOT, &&op_NEGATE, &&op_POSTFIX,
+            &&op_BINARY, &&op_SHIFT, &&op_BOOLEAN, &&op_JUMP, &&op_JUMP_IF_FALSE,
+            &&op_JUMP_IF_FALSE_KEEP, &&op_JUMP_IF_TRUE_KEEP, &&op_PREPARE_ASSIGN, &&op_ASSIGN,
+            &&op_POP, &&op_DECLARE, &&op_DECLARE_PROPERTY, &&op_INITIALIZE, &&op_RETURN, &&op_END,
+        };
+        static_assert(sizeof(dispatch_table) / sizeof(dispatch_table[0]) == (size_t)OpCode::END + 1,
+            "Dispatch table does not match OpCode");
 
-            if (function->var->is_native()) {
-                if (function->var->native_callback_ == nullptr)
-                    throw DeltaScriptException("Tried to execute native function without callback handle");
+#define VM_CASE(name) op_##name:
+#define VM_NEXT() { operand = *ip >> 8; goto *dispatch_table[*ip++ & 0xFF]; }
 
-                function->var->native_callback_(function_root, function->var->native_callback_data_);
-                function->var->increase_execution_count();
-            }
-            else {
-                Lexer* old_lex = lex_;
-                Lexer* new_lex = new Lexer(function->var->get_string());
+        VM_NEXT();
+#else
+#define VM_CASE(name) case OpCode::name:
+#define VM_NEXT() continue
 
-                lex_ = new_lex;
+        for (;;) {
+            operand = *ip >> 8;
 
-                try {
-                    process_block(can_execute);
+            switch ((OpCode)(*ip++ & 0xFF)) {
+#endif
+        VM_CASE(PUSH_UNDEFINED) {
+            sp->ref = new VariableReference(new Variable("", Variable::VariableFlags::UNDEFINED));
+            sp->parent = nullptr;
+            ++sp;
 
-                    can_execute = true;
+            VM_NEXT();
+        }
 
-                    function->var->increase_execution_count();
-                }
-                catch (DeltaScriptException & e) {
-                    delete new_lex;
-                    lex_ = old_lex;
+        VM_CASE(PUSH_NULL) {
+            sp->ref = new VariableReference(new Variable("", Variable::VariableFlags::NULL_));
+            sp->parent = nullptr;
+            ++sp;
 
-                    throw e;
-                }
+            VM_NEXT();
+        }
 
-                delete new_lex;
-                lex_ = old_lex;
-            }
+        VM_CASE(PUSH_CONSTANT) {
+            sp->ref = chunk->constants[operand];
+            sp->parent = nullptr;
+            ++sp;
 
-            scopes_.pop_back();
+            VM_NEXT();
+        }
 
-            return_var = new VariableReference(return_var_ref->var);
-            function_root->remove_reference(return_var_ref);
-            delete function_root;
+        VM_CASE(PUSH_FUNCTION) {
+            sp->ref = new VariableReference(create_function(chunk->functions[operand]));
+            sp->parent = nullptr;
+            ++sp;
 
-            if (return_var) {
-                return return_var;
-            }
-            else {
-                return new VariableReference(new Variable());
-            }
+            VM_NEXT();
         }
-        else {
-            lex_->expect_and_get_next(TokenKind::LPAREN_P);
-
-            while (lex_->c_token_kind != TokenKind::RPAREN_P) {
-                CLEAN_VAR_REFERENCE(process_base(can_execute));
 
-                if (lex_->c_token_kind != TokenKind::RPAREN_P)
-                    lex_->expect_and_get_next(TokenKind::COMMA_P);
-            }
+        VM_CASE(LOAD) {
+            VariableReference* a = slots[operand].ref;
 
-            lex_->expect_and_get_next(TokenKind::RPAREN_P);
+            if (!a) {
+                const Atom* name = chunk->atoms[operand];
+                a = find_var_in_scopes(*name);
 
-            if (lex_->c_token_kind == TokenKind::LBRACE_P) {
-                process_block(can_execute);
+                // Names that are not found are not cached, assigning to them creates a global
+                if (a)
+                    slots[operand].ref = a;
+                else
+                    a = new VariableReference(new Variable(), name->name);
             }
 
-            return function;
-        }
-    }
-
-    VariableReference* Context::process_factor(bool& can_execute) {
-        if (lex_->c_token_kind == TokenKind::LPAREN_P) {
-            lex_->parse_next_token();
-
-            VariableReference* a = process_base(can_execute);
-            lex_->expect_and_get_next(TokenKind::RPAREN_P);
+            sp->ref = a;
+            sp->parent = nullptr;
+            ++sp;
 
-            return a;
+            VM_NEXT();
         }
-        else if (lex_->c_token_kind == TokenKind::TRUE_L) {
-            lex_->parse_next_token();
 
-            return new VariableReference(new Variable(1));
-        }
-        else if (lex_->c_token_kind == TokenKind::FALSE_L) {
-            lex_->parse_next_token();
+        VM_CASE(GET_PROPERTY) {
+            // Intermediate results stay referenced, the child may be owned by them
+            StackValue* a = sp - 1;
+            const Atom* name = chunk->atoms[operand];
+            unshare_constant(a->ref);
+            VariableReference* child = find_property(a->ref->var, *name, property_caches ? property_caches[ip - code - 1] : nullptr);
 
-            return new VariableReference(new Variable(0));
-        }
-        else if (lex_->c_token_kind == TokenKind::NULL_L) {
-            lex_->parse_next_token();
+            if (!child)
+                child = a->ref->var->add_child(*name);
 
-            return new VariableReference(new Variable("", Variable::VariableFlags::NULL_));
-        }
-        else if (lex_->c_token_kind == TokenKind::UNDEFINED_K) {
-            lex_->parse_next_token();
+            a->parent = a->ref->var;
+            a->ref = child;
 
-            return new VariableReference(new Variable("", Variable::VariableFlags::UNDEFINED));
+            VM_NEXT();
         }
-        else if (lex_->c_token_kind == TokenKind::IDENTIFIER) {
-            VariableReference* a = can_execute ? find_var_in_scopes(lex_->get_token_value()) : new VariableReference(new Variable());
 
-            Variable* parent = nullptr;
+        VM_CASE(GET_INDEX) {
+            StackValue* index = --sp;
+            StackValue* a = sp - 1;
+            unshare_constant(a->ref);
+            std::string key = index->ref->var->get_string();
+            VariableReference* child = find_index(a->ref->var, key, property_caches ? property_caches[ip - code - 1] : nullptr);
 
-            if (can_execute && !a)
-                a = new VariableReference(new Variable(), lex_->get_token_value());
+            if (!child)
+                child = a->ref->var->add_child(key, new Variable("", Variable::VariableFlags::UNDEFINED));
 
-            int token_start = lex_->c_token_start;
+            CLEAN_VAR_REFERENCE(index->ref);
 
-            // TODO: Handle reserved keywords somehow
-            lex_->expect_and_get_next(TokenKind::IDENTIFIER);
+            a->parent = a->ref->var;
+            a->ref = child;
 
-            while (lex_->c_token_kind == TokenKind::LPAREN_P || lex_->c_token_kind == TokenKind::PERIOD_P || lex_->c_token_kind == TokenKind::LBRACK_P) {
-                if (lex_->c_token_kind == TokenKind::LPAREN_P) {
-                    a = process_function_call(can_execute, a, parent);
-                }
-                else if (lex_->c_token_kind == TokenKind::PERIOD_P) {
-                    lex_->parse_next_token();
+            VM_NEXT();
+        }
 
-                    if (can_execute) {
-                        const std::string& name = lex_->get_token_value();
-                        VariableReference* child = a->var->find_child(name);
+        VM_CASE(CALL) {
+            StackValue* function = sp - operand - 1;
+            size_t function_index = function - stack_.data();
 
-                        if (!child)
-                            child = find_var_in_parent_classes(a->var, name);
+            // Calls run above the arguments, and may grow the stack
+            stack_top_ = sp - stack_.data();
+            VariableReference* result = call_function(function->ref, function->parent, function + 1, operand);
 
-                        if (!child)
-                            child = a->var->add_child(name);
+            slots = stack_.data() + base;
+            sp = stack_.data() + function_index;
+            CLEAN_VAR_REFERENCE(sp->ref);
+            sp->ref = result;
+            ++sp;
 
-                        parent = a->var;
-                        a = child;
-                    }
+            VM_NEXT();
+        }
 
-                    lex_->expect_and_get_next(TokenKind::IDENTIFIER);
-                }
-                else if (lex_->c_token_kind == TokenKind::LBRACK_P) {
-                    lex_->parse_next_token();
+        VM_CASE(NOT) {
+            StackValue* a = sp - 1;
+            Variable zero(0);
+            Variable* result = a->ref->var->execute_math_operation(&zero, TokenKind::EQUAL_P);
 
-                    VariableReference* index = process_base(can_execute);
-                    lex_->expect_and_get_next(TokenKind::RBRACK_P);
+            CREATE_REFERENCE(a->ref, result);
+            a->parent = nullptr;
 
-                    if (can_execute) {
-                        VariableReference* child = a->var->find_child_or_create(index->var->get_string());
+            VM_NEXT();
+        }
 
-                        parent = a->var;
-                        a = child;
-                    }
+        VM_CASE(NEGATE) {
+            StackValue* a = sp - 1;
+            Variable zero(0);
+            Variable* result = zero.execute_math_operation(a->ref->var, TokenKind::MINUS_P);
 
-                    CLEAN_VAR_REFERENCE(index);
-                }
-            }
+            CREATE_REFERENCE(a->ref, result);
+            a->parent = nullptr;
 
-            return a;
+            VM_NEXT();
         }
-        else if (lex_->c_token_kind == TokenKind::INTEGER_L || lex_->c_token_kind == TokenKind::FLOAT_L) {
-            Variable* a = new Variable(lex_->get_token_value(), lex_->c_token_kind == TokenKind::INTEGER_L ?
-                Variable::VariableFlags::INTEGER : Variable::VariableFlags::DOUBLE);
-            lex_->parse_next_token();
 
-            return new VariableReference(a);
-        }
-        else if (lex_->c_token_kind == TokenKind::STRING_L) {
-            Variable* a = new Variable(lex_->get_token_value(), Variable::VariableFlags::STRING);
-            lex_->parse_next_token();
+        VM_CASE(POSTFIX) {
+            StackValue* a = sp - 1;
+            unshare_constant(a->ref);
+            Variable one(1);
+            Variable* result = execute_binary(a->ref->var, &one, ((TokenKind)operand == TokenKind::INCR_P) ? TokenKind::PLUS_P : TokenKind::MINUS_P, feedback[ip - code - 1]);
+            VariableReference* old_value = new VariableReference(a->ref->var);
 
-            return new VariableReference(a);
-        }
-        else if (lex_->c_token_kind == TokenKind::LBRACE_P) {
-            // TODO: Create object
-            return new VariableReference(new Variable());
-        }
-        else if (lex_->c_token_kind == TokenKind::LBRACK_P) {
-            // TODO: Create array
-            return new VariableReference(new Variable());
-        }
-        else if (lex_->c_token_kind == TokenKind::FUNCTION_K) {
-            VariableReference* func_ref = parse_function_definition();
+            a->ref->replace_with(result);
+            CLEAN_VAR_REFERENCE(a->ref);
 
-            if (func_ref->name != "")
-                throw DeltaScriptException("Functions not defined at statement-level are not meant to have a name");
+            a->ref = old_value;
+            a->parent = nullptr;
 
-            return func_ref;
+            VM_NEXT();
         }
 
-        lex_->expect_and_get_next(TokenKind::EOS);
-        return nullptr;
-    }
-
-    VariableReference* Context::process_unary(bool& can_execute) {
-        VariableReference* a;
+        VM_CASE(BINARY) {
+            StackValue* b = --sp;
+            StackValue* a = sp - 1;
+            Variable* result = execute_binary(a->ref->var, b->ref->var, (TokenKind)operand, feedback[ip - code - 1]);
 
-        if (lex_->c_token_kind == TokenKind::NOT_P) {
-            lex_->parse_next_token();
+            CREATE_REFERENCE(a->ref, result);
+            CLEAN_VAR_REFERENCE(b->ref);
+            a->parent = nullptr;
 
-            a = process_factor(can_execute);
+            VM_NEXT();
+        }
 
-            if (can_execute) {
-                Variable zero(0);
-                Variable* result = a->var->execute_math_operation(&zero, TokenKind::EQUAL_P);
+        VM_CASE(SHIFT) {
+            StackValue* b = --sp;
+            StackValue* a = sp - 1;
+            int shift = b->ref->var->get_int();
+            CLEAN_VAR_REFERENCE(b->ref);
+            unshare_constant(a->ref);
 
-                CREATE_REFERENCE(a, result);
+            switch ((TokenKind)operand) {
+            case TokenKind::SHFT_L_P:
+                a->ref->var->set_int(a->ref->var->get_int() << shift);
+                break;
+            case TokenKind::SHFT_R_P:
+                a->ref->var->set_int(a->ref->var->get_int() >> shift);
+                break;
+            case TokenKind::SHFT_RR_P:
+                a->ref->var->set_int(((unsigned int)a->ref->var->get_int()) >> shift);
+                break;
+            default:
+                break;
             }
-        }
-        else {
-            a = process_factor(can_execute);
-        }
 
-        return a;
-    }
+            a->parent = nullptr;
 
-    VariableReference* Context::process_term(bool& can_execute) {
-        VariableReference* a = process_unary(can_execute);
+            VM_NEXT();
+        }
 
-        while (lex_->c_token_kind == TokenKind::MUL_P || lex_->c_token_kind == TokenKind::DIV_P
-            || lex_->c_token_kind == TokenKind::MOD_P) {
-            TokenKind operation = lex_->c_token_kind;
-            lex_->parse_next_token();
+        VM_CASE(BOOLEAN) {
+            StackValue* b = --sp;
+            StackValue* a = sp - 1;
+            Variable* new_a = new Variable(a->ref->var->get_bool());
+            Variable* new_b = new Variable(b->ref->var->get_bool());
 
-            VariableReference* b = process_unary(can_execute);
+            CREATE_REFERENCE(a->ref, new_a);
+            CREATE_REFERENCE(b->ref, new_b);
 
-            if (can_execute) {
-                Variable* result = a->var->execute_math_operation(b->var, operation);
-                CREATE_REFERENCE(a, result);
-            }
+            Variable* result = a->ref->var->execute_math_operation(b->ref->var, (TokenKind)operand);
+            CREATE_REFERENCE(a->ref, result);
+            CLEAN_VAR_REFERENCE(b->ref);
+            a->parent = nullptr;
 
-            CLEAN_VAR_REFERENCE(b);
+            VM_NEXT();
         }
 
-        return a;
-    }
-
-    VariableReference* Context::process_expression(bool& can_execute) {
-        bool negate = false;
+        VM_CASE(JUMP) {
+            ip = code + operand;
 
-        if (lex_->c_token_kind == TokenKind::MINUS_P) {
-            lex_->parse_next_token();
-            negate = true;
+            VM_NEXT();
         }
 
-        VariableReference* a = process_term(can_execute);
+        VM_CASE(JUMP_IF_FALSE) {
+            StackValue* condition = --sp;
+            bool condition_met = condition->ref->var->get_bool();
+            CLEAN_VAR_REFERENCE(condition->ref);
 
-        if (negate) {
-            Variable zero(0);
-            Variable* result = zero.execute_math_operation(a->var, TokenKind::MINUS_P);
+            if (!condition_met)
+                ip = code + operand;
 
-            CREATE_REFERENCE(a, result);
+            VM_NEXT();
         }
 
-        while (lex_->c_token_kind == TokenKind::PLUS_P || lex_->c_token_kind == TokenKind::MINUS_P
-            || lex_->c_token_kind == TokenKind::INCR_P || lex_->c_token_kind == TokenKind::DECR_P) {
-            TokenKind operation = lex_->c_token_kind;
-            lex_->parse_next_token();
+        VM_CASE(JUMP_IF_FALSE_KEEP) {
+            if (!(sp - 1)->ref->var->get_bool())
+                ip = code + operand;
 
-            if (operation == TokenKind::INCR_P || operation == TokenKind::DECR_P) {
-                if (can_execute) {
-                    Variable one(1);
-                    Variable* result = a->var->execute_math_operation(&one, (operation == TokenKind::INCR_P) ? TokenKind::PLUS_P : TokenKind::MINUS_P);
-                    VariableReference* old_value = new VariableReference(a->var);
-
-                    a->replace_with(result);
-                    CLEAN_VAR_REFERENCE(a);
-                    a = old_value;
-                }
-            }
-            else {
-                VariableReference* b = process_term(can_execute);
-
-                if (can_execute) {
-                    Variable* result = a->var->execute_math_operation(b->var, operation);
-                    CREATE_REFERENCE(a, result);
-                }
-
-                CLEAN_VAR_REFERENCE(b);
-            }
+            VM_NEXT();
         }
 
-        return a;
-    }
+        VM_CASE(JUMP_IF_TRUE_KEEP) {
+            if ((sp - 1)->ref->var->get_bool())
+                ip = code + operand;
 
-    VariableReference* Context::process_shift(bool& can_execute) {
-        VariableReference* a = process_expression(can_execute);
-
-        if (lex_->c_token_kind == TokenKind::SHFT_L_P || lex_->c_token_kind == TokenKind::SHFT_R_P
-            || lex_->c_token_kind == TokenKind::SHFT_RR_P) {
-            TokenKind operation = lex_->c_token_kind;
-            lex_->parse_next_token();
-
-            VariableReference* b = process_base(can_execute);
-            int shift = can_execute ? b->var->get_int() : 0;
-            CLEAN_VAR_REFERENCE(b);
-
-            if (can_execute) {
-                switch (operation) {
-                case DeltaScript::TokenKind::SHFT_L_P:
-                    a->var->set_int(a->var->get_int() << shift);
-                    break;
-                case DeltaScript::TokenKind::SHFT_R_P:
-                    a->var->set_int(a->var->get_int() >> shift);
-                    break;
-                case DeltaScript::TokenKind::SHFT_RR_P:
-                    a->var->set_int(((unsigned int)a->var->get_int()) >> shift);
-                    break;
-                }
-            }
+            VM_NEXT();
         }
 
-        return a;
-    }
-
-    VariableReference* Context::process_condition(bool& can_execute) {
-        VariableReference* a = process_shift(can_execute);
-
-        while (lex_->c_token_kind == TokenKind::EQUAL_P || lex_->c_token_kind == TokenKind::NEQUAL_P
-            || lex_->c_token_kind == TokenKind::STRICT_EQUAL_P || lex_->c_token_kind == TokenKind::STRICT_NEQUAL_P
-            || lex_->c_token_kind == TokenKind::LTE_P || lex_->c_token_kind == TokenKind::GTE_P
-            || lex_->c_token_kind == TokenKind::LT_P || lex_->c_token_kind == TokenKind::GT_P) {
-            TokenKind operation = lex_->c_token_kind;
-            lex_->parse_next_token();
+        VM_CASE(PREPARE_ASSIGN) {
+            StackValue* lhs = sp - 1;
 
-            VariableReference* b = process_shift(can_execute);
-
-            if (can_execute) {
-                Variable* result = a->var->execute_math_operation(b->var, operation);
-
-                CREATE_REFERENCE(a, result);
+            if (!lhs->ref->owner || lhs->ref->var->is_constant()) {
+                if (lhs->ref->name.length() > 0) {
+                    VariableReference* real_lhs = root_->add_child(lhs->ref->name, lhs->ref->var);
+                    CLEAN_VAR_REFERENCE(lhs->ref);
+                    lhs->ref = real_lhs;
+                }
+                else {
+                    throw DeltaScriptException("Trying to assign to an unnamed type");
+                }
             }
 
-            CLEAN_VAR_REFERENCE(b);
+            VM_NEXT();
         }
 
-        return a;
-    }
-
-    VariableReference* Context::process_logic(bool& can_execute) {
-        VariableReference* a = process_condition(can_execute);
-        VariableReference* b;
-
-        while (lex_->c_token_kind == TokenKind::BIT_AND_P || lex_->c_token_kind == TokenKind::BIT_OR_P
-            || lex_->c_token_kind == TokenKind::AND_P || lex_->c_token_kind == TokenKind::OR_P) {
-            bool no_execute = false;
-            TokenKind operation = lex_->c_token_kind;
-            lex_->parse_next_token();
+        VM_CASE(ASSIGN) {
+            StackValue* rhs = --sp;
+            StackValue* lhs = sp - 1;
 
-            bool short_circuit_operation = false;
-            bool boolean = false;
-
-            if (operation == TokenKind::AND_P) {
-                operation = TokenKind::BIT_AND_P;
-                short_circuit_operation = !a->var->get_bool();
-                boolean = true;
+            if ((TokenKind)operand == TokenKind::ASSIGN_P) {
+                lhs->ref->replace_with(get_bindable_value(rhs->ref->var));
             }
-            else if (operation == TokenKind::OR_P) {
-                operation = TokenKind::BIT_OR_P;
-                short_circuit_operation = a->var->get_bool();
-                boolean = true;
+            else {
+                Variable* result = execute_binary(lhs->ref->var, rhs->ref->var, (TokenKind)operand == TokenKind::PLUS_EQ_P ? TokenKind::PLUS_P : TokenKind::MINUS_P, feedback[ip - code - 1]);
+                lhs->ref->replace_with(result);
             }
 
-            b = process_condition(short_circuit_operation ? no_execute : can_execute);
-            if (can_execute && !short_circuit_operation) {
-                if (boolean) {
-                    Variable* new_a = new Variable(a->var->get_bool());
-                    Variable* new_b = new Variable(b->var->get_bool());
+            CLEAN_VAR_REFERENCE(rhs->ref);
+            lhs->parent = nullptr;
 
-                    CREATE_REFERENCE(a, new_a);
-                    CREATE_REFERENCE(b, new_b);
-                }
+            VM_NEXT();
+        }
 
-                Variable* result = a->var->execute_math_operation(b->var, operation);
-                CREATE_REFERENCE(a, result);
-            }
+        VM_CASE(POP) {
+            --sp;
+            CLEAN_VAR_REFERENCE(sp->ref);
 
-            CLEAN_VAR_REFERENCE(b);
+            VM_NEXT();
         }
 
-        return a;
-    }
-
-    VariableReference* Context::process_ternary(bool& can_execute) {
-        VariableReference* lhs = process_logic(can_execute);
-        bool no_execute = false;
+        VM_CASE(DECLARE) {
+            sp->ref = slots[operand].ref = scopes_.back()->find_child_or_create(*chunk->atoms[operand]);
+            sp->parent = nullptr;
+            ++sp;
 
-        if (lex_->c_token_kind == TokenKind::CONDITIONAL_P) {
-            lex_->parse_next_token();
+            VM_NEXT();
+        }
 
-            if (!can_execute) {
-                CLEAN_VAR_REFERENCE(lhs);
-                CLEAN_VAR_REFERENCE(process_base(no_execute));
+        VM_CASE(DECLARE_PROPERTY) {
+            StackValue* a = sp - 1;
+            a->ref = a->ref->var->find_child_or_create(*chunk->atoms[operand]);
 
-                lex_->expect_and_get_next(TokenKind::COLON_P);
-                CLEAN_VAR_REFERENCE(process_base(no_execute));
-            }
-            else {
-                bool first = lhs->var->get_bool();
-                CLEAN_VAR_REFERENCE(lhs);
+            VM_NEXT();
+        }
 
-                if (first) {
-                    lhs = process_base(can_execute);
+        VM_CASE(INITIALIZE) {
+            StackValue* value = --sp;
 
-                    lex_->expect_and_get_next(TokenKind::COLON_P);
-                    CLEAN_VAR_REFERENCE(process_base(no_execute));
-                }
-                else {
-                    CLEAN_VAR_REFERENCE(process_base(no_execute));
+            (sp - 1)->ref->replace_with(get_bindable_value(value->ref->var));
+            CLEAN_VAR_REFERENCE(value->ref);
 
-                    lex_->expect_and_get_next(TokenKind::COLON_P);
-                    lhs = process_base(can_execute);
-                }
-            }
+            VM_NEXT();
         }
 
-        return lhs;
-    }
-
-    VariableReference* Context::process_base(bool& can_execute) {
-        VariableReference* lhs = process_ternary(can_execute);
+        VM_CASE(RETURN) {
+            VariableReference* result = operand ? (--sp)->ref : nullptr;
 
-        if (lex_->c_token_kind == TokenKind::ASSIGN_P || lex_->c_token_kind == TokenKind::PLUS_EQ_P
-            || lex_->c_token_kind == TokenKind::MINUS_EQ_P) {
-            if (can_execute && !lhs->owner) {
-                if (lhs->name.length() > 0) {
-                    VariableReference* real_lhs = root_->add_child(lhs->name, lhs->var);
-                    CLEAN_VAR_REFERENCE(lhs);
-                    lhs = real_lhs;
-                }
-                else {
-                    throw DeltaScriptException("Trying to assign to an unnamed type");
-                }
+            VariableReference* result_var = scopes_.back()->find_child("return"); // TODO: Scoping
+            if (result_var) {
+                if (result)
+                    result_var->replace_with(get_bindable_value(result->var));
+                else
+                    result_var->replace_with(new Variable());
+            }
+            else {
+                throw DeltaScriptException("Return statement is not inside function scope");
             }
 
-            TokenKind op_token = lex_->c_token_kind;
-            lex_->parse_next_token();
+            CLEAN_VAR_REFERENCE(result);
 
-            VariableReference* rhs = process_base(can_execute);
+            stack_top_ = base;
+            return;
+        }
 
-            if (can_execute) {
-                if (op_token == TokenKind::ASSIGN_P) {
-                    lhs->replace_with(rhs);
-                }
-                else if (op_token == TokenKind::PLUS_EQ_P) {
-                    Variable* result = lhs->var->execute_math_operation(rhs->var, TokenKind::PLUS_P);
-                    lhs->replace_with(result);
-                }
-                else if (op_token == TokenKind::MINUS_EQ_P) {
-                    Variable* result = lhs->var->execute_math_operation(rhs->var, TokenKind::MINUS_P);
-                    lhs->replace_with(result);
-                }
+        VM_CASE(END) {
+            stack_top_ = base;
+            return;
+        }
+#ifndef DELTASCRIPT_THREADED_DISPATCH
             }
         }
+#endif
 
-        return lhs;
+#undef VM_CASE
+#undef VM_NEXT
     }
 
-    void Context::process_block(bool& can_execute) {
-        lex_->expect_and_get_next(TokenKind::LBRACE_P);
+    VariableReference* Context::call_function(VariableReference* function, Variable* parent, StackValue* arguments, size_t argument_count) {
+        if (!function->var->is_function()) {
+            std::stringstream msg;
+            msg << "Expecting '" << function->name << "' to be a function";
 
-        if (can_execute) {
-            while (lex_->c_token_kind != TokenKind::EOS && lex_->c_token_kind != TokenKind::RBRACE_P)
-                process_statement(can_execute);
-
-            lex_->expect_and_get_next(TokenKind::RBRACE_P);
+            throw DeltaScriptException(msg.str());
         }
-        else {
-            int braces = 1;
 
-            while (lex_->c_token_kind != TokenKind::EOS && braces > 0) {
-                if (lex_->c_token_kind == TokenKind::LBRACE_P) {
-                    ++braces;
-                }
-                else if (lex_->c_token_kind == TokenKind::RBRACE_P) {
-                    --braces;
-                }
+        size_t parameter_count = function->var->get_children_count();
 
-                lex_->parse_next_token();
-            }
+        if (parameter_count != argument_count) {
+            std::stringstream msg;
+            msg << "Function '" << function->name << "' expects " << parameter_count
+                << " arguments, got " << argument_count;
+
+            throw DeltaScriptException(msg.str());
         }
-    }
 
-    void Context::process_statement(bool& can_execute) {
-        if (lex_->c_token_kind == TokenKind::IDENTIFIER || lex_->c_token_kind == TokenKind::INTEGER_L
-            || lex_->c_token_kind == TokenKind::FLOAT_L || lex_->c_token_kind == TokenKind::STRING_L
-            || lex_->c_token_kind == TokenKind::MINUS_P) {
+        VariableReference* jit_result = call_jit_code(function->var, arguments, argument_count);
 
-            CLEAN_VAR_REFERENCE(process_base(can_execute));
+        if (jit_result)
+            return jit_result;
 
-            lex_->expect_and_get_next(TokenKind::SEMICOLON_P);
-        }
-        else if (lex_->c_token_kind == TokenKind::LBRACE_P) {
-            process_block(can_execute);
-        }
-        else if (lex_->c_token_kind == TokenKind::SEMICOLON_P) {
-            lex_->parse_next_token();
-        }
-        else if (lex_->c_token_kind == TokenKind::VAR_K) {
-            lex_->parse_next_token();
+        Variable* function_root = new Variable("", Variable::VariableFlags::FUNCTION);
 
-            while (lex_->c_token_kind != TokenKind::SEMICOLON_P) {
-                VariableReference* ref = nullptr;
+        if (parent)
+            function_root->add_child("this", parent);
 
-                if (can_execute)
-                    ref = scopes_.back()->find_child_or_create(lex_->get_token_value());
+        // Parameters are the children of the function, the slots of removed ones are nullptr
+        VariableReference* const* v = function->var->slots_.data();
 
-                lex_->expect_and_get_next(TokenKind::IDENTIFIER);
+        for (size_t i = 0; i < argument_count; ++i, ++v) {
+            VariableReference* value = arguments[i].ref;
 
-                while (lex_->get_current_token() == TokenKind::PERIOD_P) {
-                    lex_->parse_next_token();
+            while (!*v)
+                ++v;
 
-                    if (can_execute) {
-                        VariableReference* last_ref = ref;
-                        ref = last_ref->var->find_child_or_create(lex_->get_token_value());
-                    }
+            if (value->var->is_basic()) {
+                function_root->add_child((*v)->name, value->var->deep_copy());
+            }
+            else {
+                function_root->add_child((*v)->name, value->var);
+            }
 
-                    lex_->expect_and_get_next(TokenKind::IDENTIFIER);
-                }
+            CLEAN_VAR_REFERENCE(value);
+        }
 
-                if (lex_->get_current_token() == TokenKind::ASSIGN_P) {
-                    lex_->parse_next_token();
+        VariableReference* return_var = nullptr;
+        VariableReference* return_var_ref = function_root->add_child("return");
 
-                    VariableReference* ref_2 = process_base(can_execute);
+        scopes_.push_back(function_root);
 
-                    if (can_execute)
-                        ref->replace_with(ref_2);
+        if (function->var->is_native()) {
+            if (function->var->native_callback_ == nullptr)
+                throw DeltaScriptException("Tried to execute native function without callback handle");
 
-                    CLEAN_VAR_REFERENCE(ref_2);
-                }
+            function->var->native_callback_(function_root, function->var->native_callback_data_);
+            function->var->increase_execution_count();
+        }
+        else {
+            // Functions created from text are compiled on the first call, setting a new body drops the code
+            if (!function->var->function_code_) {
+                std::shared_ptr<const Source> source = Source::from_string(function->var->get_string());
+                Lexer lex(source, atoms_.get());
+                Parser parser(&lex);
 
-                if (lex_->get_current_token() != TokenKind::SEMICOLON_P) {
-                    lex_->expect_and_get_next(TokenKind::COMMA_P);
-                }
+                function->var->function_code_ = Compiler::compile(parser.parse_block().get(), atoms_, source);
             }
 
-            lex_->expect_and_get_next(TokenKind::SEMICOLON_P);
-        }
-        else if (lex_->c_token_kind == TokenKind::IF_K) {
-            lex_->parse_next_token();
+            // Hold on to the code in case the function body gets replaced while it runs
+            std::shared_ptr<const Chunk> code = function->var->function_code_;
 
-            lex_->expect_and_get_next(TokenKind::LPAREN_P);
-            VariableReference* ref = process_base(can_execute);
-            lex_->expect_and_get_next(TokenKind::RPAREN_P);
+            run(code->get_compiled());
 
-            bool condition_met = can_execute && ref->var->get_bool();
-            CLEAN_VAR_REFERENCE(ref);
+            function->var->increase_execution_count();
+        }
 
-            bool no_execute = false;
+        scopes_.pop_back();
 
-            process_statement(condition_met ? can_execute : no_execute);
+        // The root goes away next, so the return value is released without removing it, which
+        // would turn the shape into a dictionary whenever the body declared a local
+        return_var = new VariableReference(return_var_ref->var);
+        delete function_root;
+        delete return_var_ref;
 
-            if (lex_->c_token_kind == TokenKind::ELSE_K) {
-                lex_->parse_next_token();
+        return return_var;
+    }
 
-                process_statement(condition_met ? no_execute : can_execute);
+    Variable* Context::execute_binary(Variable* a, Variable* b, TokenKind operation, std::atomic<unsigned char>& feedback) {
+        unsigned int a_type = a->flags_ & Variable::VariableFlags::VARTYPE;
+        unsigned int b_type = b->flags_ & Variable::VariableFlags::VARTYPE;
+        unsigned char types = TypeFeedback::GENERIC;
+
+        if (a_type == b_type) {
+            if (a_type == Variable::VariableFlags::INTEGER)
+                types = TypeFeedback::INTEGERS;
+            else if (a_type == Variable::VariableFlags::DOUBLE)
+                types = TypeFeedback::DOUBLES;
+            else if (a_type == Variable::VariableFlags::STRING)
+                types = TypeFeedback::STRINGS;
+        }
+
+        unsigned char seen = feedback.load(std::memory_order_relaxed);
+
+        // The guard, a site that sees another pair stops looking for one
+        if (seen != types) {
+            if (seen == TypeFeedback::GENERIC)
+                return a->execute_math_operation(b, operation);
+
+            seen = seen == TypeFeedback::UNSEEN ? types : (unsigned char)TypeFeedback::GENERIC;
+            feedback.store(seen, std::memory_order_relaxed);
+
+            if (seen == TypeFeedback::GENERIC)
+                return a->execute_math_operation(b, operation);
+        }
+
+        // Same results as execute_math_operation for these types, without its type checks
+        switch (seen) {
+        case TypeFeedback::INTEGERS: {
+            int a_i = (int)a->int_data_;
+            int b_i = (int)b->int_data_;
+
+            switch (operation) {
+            case TokenKind::PLUS_P: return new Variable(a_i + b_i);
+            case TokenKind::MINUS_P: return new Variable(a_i - b_i);
+            case TokenKind::MUL_P: return new Variable(a_i * b_i);
+            case TokenKind::DIV_P: return new Variable(a_i / b_i);
+            case TokenKind::MOD_P: return new Variable(a_i % b_i);
+            case TokenKind::BIT_AND_P: return new Variable(a_i & b_i);
+            case TokenKind::BIT_OR_P: return new Variable(a_i | b_i);
+            case TokenKind::BIT_XOR_P: return new Variable(a_i ^ b_i);
+            case TokenKind::EQUAL_P:
+            case TokenKind::STRICT_EQUAL_P: return new Variable(a_i == b_i);
+            case TokenKind::NEQUAL_P:
+            case TokenKind::STRICT_NEQUAL_P: return new Variable(a_i != b_i);
+            case TokenKind::LT_P: return new Variable(a_i < b_i);
+            case TokenKind::LTE_P: return new Variable(a_i <= b_i);
+            case TokenKind::GT_P: return new Variable(a_i > b_i);
+            case TokenKind::GTE_P: return new Variable(a_i >= b_i);
+            default: break;
+            }
+            break;
+        }
+
+        case TypeFeedback::DOUBLES: {
+            double a_d = a->double_data_;
+            double b_d = b->double_data_;
+
+            switch (operation) {
+            case TokenKind::PLUS_P: return new Variable(a_d + b_d);
+            case TokenKind::MINUS_P: return new Variable(a_d - b_d);
+            case TokenKind::MUL_P: return new Variable(a_d * b_d);
+            case TokenKind::DIV_P: return new Variable(a_d / b_d);
+            case TokenKind::EQUAL_P:
+            case TokenKind::STRICT_EQUAL_P: return new Variable(a_d == b_d);
+            case TokenKind::NEQUAL_P:
+            case TokenKind::STRICT_NEQUAL_P: return new Variable(a_d != b_d);
+            case TokenKind::LT_P: return new Variable(a_d < b_d);
+            case TokenKind::LTE_P: return new Variable(a_d <= b_d);
+            case TokenKind::GT_P: return new Variable(a_d > b_d);
+            case TokenKind::GTE_P: return new Variable(a_d >= b_d);
+            default: break;
             }
+            break;
+        }
+
+        case TypeFeedback::STRINGS:
+            switch (operation) {
+            case TokenKind::PLUS_P: return new Variable(a->str_data_ + b->str_data_);
+            // Ordering strings compares them for equality, as execute_math_operation does
+            case TokenKind::EQUAL_P:
+            case TokenKind::STRICT_EQUAL_P:
+            case TokenKind::LT_P:
+            case TokenKind::LTE_P:
+            case TokenKind::GT_P:
+            case TokenKind::GTE_P: return new Variable(a->str_data_ == b->str_data_);
+            case TokenKind::NEQUAL_P:
+            case TokenKind::STRICT_NEQUAL_P: return new Variable(a->str_data_ != b->str_data_);
+            default: break;
+            }
+            break;
+
+        default:
+            break;
         }
-        else if (lex_->c_token_kind == TokenKind::WHILE_K) {
-            lex_->parse_next_token();
 
-            lex_->expect_and_get_next(TokenKind::LPAREN_P);
-            int while_condition_start = lex_->c_token_start;
+        // Operations the fast paths leave out, execute_math_operation reports them
+        return a->execute_math_operation(b, operation);
+    }
 
-            bool no_execute = false;
-            VariableReference* condition = process_base(can_execute);
-            bool loop_condition = can_execute && condition->var->get_bool();
-            CLEAN_VAR_REFERENCE(condition);
+    VariableReference* Context::call_jit_code(Variable* function, StackValue* arguments, size_t argument_count) {
+        if (!jit_enabled_ || function->is_native() || !function->function_code_
+            || function->execution_count_ < jit_threshold_ || argument_count > JitCode::max_parameters)
+            return nullptr;
 
-            Lexer* while_cond_lex = lex_->get_sub_lex(while_condition_start);
-            lex_->expect_and_get_next(TokenKind::RPAREN_P);
-            int while_body_start = lex_->c_token_start;
+        const Chunk* code = function->function_code_->get_compiled();
+        const JitCode* jit_code = code->get_jit_code();
 
-            process_statement(loop_condition ? can_execute : no_execute);
-            Lexer* while_body_lex = lex_->get_sub_lex(while_body_start);
-            Lexer* old_lex = lex_;
+        if (!jit_code || jit_code->is_retired())
+            return nullptr;
 
-            while (loop_condition) {
-                while_cond_lex->reset();
-                lex_ = while_cond_lex;
+        int64_t values[JitCode::max_parameters];
 
-                condition = process_base(can_execute);
+        for (size_t i = 0; i < argument_count; ++i) {
+            Variable* value = arguments[i].ref->var;
 
-                loop_condition = can_execute && condition->var->get_bool();
-                CLEAN_VAR_REFERENCE(condition);
+            // The code only computes in 32 bits, wider integers keep their value in the interpreter
+            if (!value->is_int() || value->int_data_ != (int)value->int_data_)
+                return nullptr;
 
-                if (loop_condition) {
-                    while_body_lex->reset();
-                    lex_ = while_body_lex;
+            values[i] = value->int_data_;
+        }
 
-                    process_statement(can_execute);
-                }
-            }
+        // Calls to itself are compiled as direct calls, the body sees the caller's scopes
+        // beyond its own names
+        if (jit_code->calls_self()) {
+            VariableReference* self = find_var_in_scopes(*code->name);
 
-            lex_ = old_lex;
-            delete while_cond_lex;
-            delete while_body_lex;
+            if (!self || self->var->function_code_ != function->function_code_)
+                return nullptr;
         }
-        else if (lex_->c_token_kind == TokenKind::FOR_K) {
-            lex_->parse_next_token();
-            lex_->expect_and_get_next(TokenKind::LPAREN_P);
 
-            process_statement(can_execute);
+        int result;
 
-            int for_condition_start = lex_->c_token_start;
-            bool no_execute = false;
+        if (!jit_code->run(values, result))
+            return nullptr;
 
-            VariableReference* condition = process_base(can_execute);
-            bool loop_condition = can_execute && condition->var->get_bool();
-            CLEAN_VAR_REFERENCE(condition);
+        for (size_t i = 0; i < argument_count; ++i)
+            CLEAN_VAR_REFERENCE(arguments[i].ref);
 
-            Lexer* for_condition_lex = lex_->get_sub_lex(for_condition_start);
-            lex_->expect_and_get_next(TokenKind::SEMICOLON_P);
+        function->increase_execution_count();
 
-            int for_iterator_start = lex_->c_token_start;
-            CLEAN_VAR_REFERENCE(process_base(no_execute));
+        return new VariableReference(new Variable(result));
+    }
 
-            Lexer* for_iterator_lex = lex_->get_sub_lex(for_iterator_start);
-            lex_->expect_and_get_next(TokenKind::RPAREN_P);
+    Variable* Context::create_function(const std::shared_ptr<const Chunk>& definition) {
+        Variable* function = new Variable("", Variable::VariableFlags::FUNCTION);
 
-            int for_body_start = lex_->c_token_start;
+        for (const Atom* argument : definition->parameters)
+            function->add_child(*argument);
 
-            process_statement(loop_condition ? can_execute : no_execute);
+        function->str_data_ = definition->get_source();
+        function->function_code_ = definition;
 
-            Lexer* for_body_lex = lex_->get_sub_lex(for_body_start);
-            Lexer* old_lex = lex_;
+        return function;
+    }
 
-            if (loop_condition) {
-                for_iterator_lex->reset();
-                lex_ = for_iterator_lex;
+    void Context::set_jit_enabled(bool enabled) {
+        jit_enabled_ = enabled;
+    }
 
-                CLEAN_VAR_REFERENCE(process_base(can_execute));
-            }
+    void Context::set_jit_threshold(int threshold) {
+        jit_threshold_ = threshold;
+    }
 
-            while (can_execute && loop_condition) {
-                for_condition_lex->reset();
-                lex_ = for_condition_lex;
+    void Context::set_specialization_enabled(bool enabled) {
+        specialization_enabled_ = enabled;
+    }
 
-                condition = process_base(can_execute);
-                loop_condition = condition->var->get_bool();
-                CLEAN_VAR_REFERENCE(condition);
+    VariableReference* Context::find_var_in_scopes(const Atom& child_name) {
+        for (int i = (int)scopes_.size() - 1; i >= 0; --i) {
+            VariableReference* ref = scopes_[i]->find_child(child_name);
 
-                if (can_execute && loop_condition) {
-                    for_body_lex->reset();
-                    lex_ = for_body_lex;
+            if (ref)
+                return ref;
+        }
 
-                    process_statement(can_execute);
-                }
+        return nullptr;
+    }
 
-                if (can_execute && loop_condition) {
-                    for_iterator_lex->reset();
-                    lex_ = for_iterator_lex;
+    VariableReference* Context::find_var_in_parent_classes(Variable* object, const Atom& name) {
+        VariableReference* parent_class = object->find_child("prototype");
 
-                    CLEAN_VAR_REFERENCE(process_base(can_execute));
-                }
-            }
+        while (parent_class) {
+            VariableReference* implementation = parent_class->var->find_child(name);
 
-            lex_ = old_lex;
-            delete for_condition_lex;
-            delete for_iterator_lex;
-            delete for_body_lex;
-        }
-        else if (lex_->c_token_kind == TokenKind::RETURN_K) {
-            lex_->parse_next_token();
-            VariableReference* result = nullptr;
+            if (implementation)
+                return implementation;
 
-            if (lex_->c_token_kind != TokenKind::SEMICOLON_P)
-                result = process_base(can_execute);
+            parent_class = parent_class->var->find_child("prototype");
+        }
 
-            if (can_execute) {
-                VariableReference* result_var = scopes_.back()->find_child("return"); // TODO: Scoping
-                if (result_var) {
-                    result_var->replace_with(result);
-                }
-                else {
-                    throw DeltaScriptException("Return statement is not inside function scope");
-                }
+        // TODO: Add expansions for natively supported types (string, array, object)
 
-                can_execute = false;
-            }
+        return nullptr;
+    }
 
-            CLEAN_VAR_REFERENCE(result);
+    VariableReference* Context::find_property(Variable* object, const Atom& name, PropertyCache* cache) {
+        if (!cache) {
+            VariableReference* child = object->find_child(name);
 
-            lex_->expect_and_get_next(TokenKind::SEMICOLON_P);
+            return child ? child : find_var_in_parent_classes(object, name);
         }
-        else if (lex_->c_token_kind == TokenKind::FUNCTION_K) {
-            VariableReference* function_var = parse_function_definition();
 
-            if (can_execute) {
-                if (function_var->name == "") {
-                    throw DeltaScriptException("Functions defined at statement-level are meant to have a name");
-                }
-                else {
-                    scopes_.back()->add_child(function_var->name, function_var->var);
-                }
+        unsigned long long layout = object->get_layout();
 
-                CLEAN_VAR_REFERENCE(function_var);
-            }
-        }
-        else { // TODO: Other reserved words
-            lex_->expect_and_get_next(TokenKind::EOS);
-        }
-    }
+        for (const PropertyCache::Entry& entry : cache->entries) {
+            if (entry.layout != layout)
+                continue;
 
-    VariableReference* Context::parse_function_definition() {
-        lex_->expect_and_get_next(TokenKind::FUNCTION_K);
+            if (!entry.prototype_layout)
+                return object->slots_[entry.slot];
 
-        std::string function_name = "";
+            Variable* prototype = object->slots_[entry.prototype_slot]->var;
 
-        if (lex_->c_token_kind == TokenKind::IDENTIFIER) {
-            function_name = lex_->get_token_value();
-            lex_->parse_next_token();
+            if (prototype->get_layout() == entry.prototype_layout)
+                return prototype->slots_[entry.slot];
         }
 
-        VariableReference* function_ref = new VariableReference(new Variable("", Variable::VariableFlags::FUNCTION), function_name);
-        parse_function_arguments(function_ref->var);
+        int slot = object->find_slot(name.name, name.hash);
 
-        int function_begin = lex_->c_token_start;
-        bool no_execute = false;
+        if (slot >= 0) {
+            cache->entries[cache->next++ % PropertyCache::size] = { layout, (unsigned int)slot, 0, 0 };
 
-        process_block(no_execute);
+            return object->slots_[slot];
+        }
 
-        function_ref->var->str_data_ = lex_->get_sub_string(function_begin);
+        // Computed children such as length are not in a slot and are not cached
+        VariableReference* child = object->find_child(name);
 
-        return function_ref;
-    }
+        if (child)
+            return child;
 
-    void Context::parse_function_arguments(Variable* function_variable) {
-        lex_->expect_and_get_next(TokenKind::LPAREN_P);
+        child = find_var_in_parent_classes(object, name);
 
-        while (lex_->c_token_kind != TokenKind::RPAREN_P) {
-            function_variable->add_child(lex_->get_token_value());
+        // Only properties of the direct prototype are cached. Arrays and strings have a computed
+        // length, which an object turned into one would not find in its prototype.
+        if (child && name.name != "length") {
+            int prototype_slot = object->find_slot("prototype", Util::hash_name("prototype"));
 
-            lex_->expect_and_get_next(TokenKind::IDENTIFIER);
+            if (prototype_slot >= 0) {
+                Variable* prototype = object->slots_[prototype_slot]->var;
+                slot = prototype->find_slot(name.name, name.hash);
 
-            if (lex_->c_token_kind != TokenKind::RPAREN_P)
-                lex_->expect_and_get_next(TokenKind::COMMA_P);
+                if (slot >= 0 && prototype->slots_[slot] == child)
+                    cache->entries[cache->next++ % PropertyCache::size] = { layout, (unsigned int)slot, (unsigned int)prototype_slot, prototype->get_layout() };
+            }
         }
 
-        lex_->expect_and_get_next(TokenKind::RPAREN_P);
+        return child;
     }
 
-    VariableReference* Context::find_var_in_scopes(const std::string& child_name) {
-        for (int i = (int)scopes_.size() - 1; i >= 0; --i) {
-            VariableReference* ref = scopes_[i]->find_child(child_name);
-
-            if (ref)
-                return ref;
-        }
-
-        return nullptr;
-    }
+    VariableReference* Context::find_index(Variable* object, const std::string& key, PropertyCache* cache) {
+        if (!cache)
+            return object->find_child(key);
 
-    VariableReference* Context::find_var_in_parent_classes(Variable* object, const std::string& name) {
-        VariableReference* parent_class = object->find_child("prototype");
+        unsigned long long layout = object->get_layout();
 
-        while (parent_class) {
-            VariableReference* implementation = parent_class->var->find_child(name);
+        for (const PropertyCache::Entry& entry : cache->entries) {
+            if (entry.layout == layout && object->slots_[entry.slot]->name == key)
+                return object->slots_[entry.slot];
+        }
 
-            if (implementation)
-                return implementation;
+        int slot = object->find_slot(key, Util::hash_name(key));
 
-            parent_class = parent_class->var->find_child("prototype");
-        }
+        if (slot < 0)
+            return object->find_child(key);
 
-        // TODO: Add expansions for natively supported types (string, array, object)
+        cache->entries[cache->next++ % PropertyCache::size] = { layout, (unsigned int)slot, 0, 0 };
 
-        return nullptr;
+        return object->slots_[slot];
     }
 }  // namespace DeltaScript
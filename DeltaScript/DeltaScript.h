@@ -2,8 +2,14 @@
 #define DELTASCRIPT_DELTASCRIPT_H_
 
 #include <string>
+#include <string_view>
 #include <vector>
+#include <memory>
+#include <deque>
 #include <unordered_map>
+#include <mutex>
+#include <atomic>
+#include <cstdint>
 
 #define CLEAN_VAR_REFERENCE(x) { VariableReference* v = x; if (v && !v->owner) delete v; }
 #define CREATE_REFERENCE(ref, var) { if (!ref || ref->owner) ref = new VariableReference(var); else ref->replace_with(var); }
@@ -120,8 +126,104 @@ namespace DeltaScript {
 
     class Token {
     public:
+        TokenKind kind;
+        int start;
+        int end;
+        // Index into the lexer value table for the token kind (atoms for identifiers, integers,
+        // floats or materialized strings), -1 if the value is a view into the source. For
+        // brackets it is the index of the matching bracket token, -1 if there is none.
+        int value;
+
         static std::string get_position_info(const char* source, size_t source_length, int position);
         static std::string get_token_kind_as_string(TokenKind kind);
+        static TokenKind get_keyword_kind(const char* value, size_t length);
+    };
+
+    // Offsets at which each line of a source starts, for turning source positions into
+    // line and column numbers with a binary search
+    class LineIndex {
+    private:
+        std::vector<size_t> line_starts_;
+
+    public:
+        LineIndex(const char* source, size_t source_length);
+        LineIndex(std::vector<size_t> line_starts);
+
+        size_t get_line_count() const;
+        size_t get_line_start(int line) const;
+        int get_line(int position) const;
+        void get_line_and_column(int position, int& line, int& column) const;
+        std::string get_position_info(int position) const;
+    };
+
+    // Read-only view of a whole file, memory-mapped where the platform supports it
+    class MappedFile {
+    private:
+        const char* data_;
+        size_t size_;
+        std::string buffer_;
+        bool mapped_;
+
+    public:
+        MappedFile(const std::string& path);
+        ~MappedFile();
+
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        const char* data() const;
+        size_t size() const;
+    };
+
+    // Immutable script text, shared by reference between lexers and safe to read from several
+    // threads at once. The line index is built on the first position query.
+    class Source {
+    private:
+        std::string text_;
+        std::unique_ptr<MappedFile> file_;
+        const char* data_;
+        size_t size_;
+        mutable std::once_flag line_index_once_;
+        mutable std::unique_ptr<LineIndex> line_index_;
+
+        Source();
+
+    public:
+        static std::shared_ptr<const Source> from_string(std::string text);
+        // Memory-maps the file read-only
+        static std::shared_ptr<const Source> from_file(const std::string& path);
+
+        Source(const Source&) = delete;
+        Source& operator=(const Source&) = delete;
+
+        const char* data() const;
+        size_t size() const;
+        const LineIndex& get_line_index() const;
+
+    private:
+        // Supplies a line index built elsewhere, if none was built yet
+        void set_line_index(std::unique_ptr<LineIndex> line_index) const;
+
+        friend class ScriptCache;
+    };
+
+    // Interned identifier, its hash is computed once when it is interned
+    class Atom {
+    public:
+        std::string name;
+        size_t hash;
+    };
+
+    // Hands out a small integer id per distinct identifier, ids stay valid for the table lifetime
+    class AtomTable {
+    private:
+        std::unordered_map<std::string_view, int> ids_;
+        std::deque<Atom> atoms_;
+
+    public:
+        int intern(std::string_view name);
+        const Atom& get(int id) const;
+        size_t size() const;
     };
 
     class DeltaScriptException {
@@ -143,40 +245,68 @@ namespace DeltaScript {
 
     class Lexer {
     private:
-        char* source_;
-        int source_start_;
+        std::shared_ptr<const Source> source_buffer_;
+        const char* source_;
+        size_t source_begin_;
         size_t source_end_;
         int c_source_position_;
-        bool source_owner;
 
         char c_char = 0, n_char = 0;
+
+        std::vector<Token> tokens_;
+        std::vector<std::string> token_values_;
+        std::vector<long long> token_integers_;
+        std::vector<double> token_floats_;
+        size_t c_token_index_;
+        AtomTable* atoms_;
+        std::unique_ptr<AtomTable> own_atoms_;
     public:
         TokenKind c_token_kind = TokenKind::EOS;
         int c_token_start = 0;
     private:
-        int c_token_end = 0;
-        int p_token_end = 0;
         std::string c_token_value;
+        bool c_token_materialized = false;
 
     public:
-        Lexer(const std::string& source);
-        Lexer(Lexer* parent, int source_start, int source_end);
-        ~Lexer();
+        // Identifiers are interned into atoms, or into a table private to the lexer if none is given
+        Lexer(const std::string& source, AtomTable* atoms = nullptr);
+        // Lexes the shared source in place, the source is only ever read
+        Lexer(std::shared_ptr<const Source> source, AtomTable* atoms = nullptr);
+        // Lexes the part of the source in [begin, end), positions stay relative to the whole source
+        Lexer(std::shared_ptr<const Source> source, size_t begin, size_t end, AtomTable* atoms = nullptr);
+
+        const std::shared_ptr<const Source>& get_source() const;
 
         TokenKind get_current_token() const;
         std::string get_token_value() const;
-        
+        std::string_view get_token_view() const;
+        const Atom& get_token_atom() const;
+        int get_token_atom_id() const;
+        long long get_token_integer() const;
+        double get_token_float() const;
+        size_t get_token_index() const;
+        size_t get_token_count() const;
+        // Index of the bracket token matching the one at token_index, -1 if there is none
+        int get_matching_token(size_t token_index) const;
+        const LineIndex& get_line_index() const;
+        std::string get_position_info(int position) const;
+
         void reset();
+        void seek(size_t token_index);
         void expect_and_get_next(TokenKind expected_kind);
-        void get_next_char();
-        void get_previous_char();
         void parse_next_token();
 
-        Lexer* get_sub_lex(int start_position);
-
         std::string get_sub_string(int start_position);
+        // Offset just past the token before the current one, where get_sub_string stops
+        int get_previous_token_end() const;
 
     private:
+        void tokenize();
+        void scan_next_token();
+        void get_next_char();
+        void get_previous_char();
+        void jump_to_char(size_t position);
+
         void process_inline_comment();
         void process_multiline_comment();
         void process_identifier();
@@ -186,12 +316,365 @@ namespace DeltaScript {
         void process_punctuators();
 
         void check_for_reserved_keywords();
+        void materialize_string_literal();
+        void skip_string_literal_run(char quote);
+    };
+
+    enum class NodeKind : unsigned char {
+        // Expressions
+        UNDEFINED,
+        NULL_,
+        INTEGER,
+        FLOAT,
+        STRING,
+        IDENTIFIER,
+        FUNCTION,   // Function expression, see FUNCTION_DECLARATION for the layout
+        PROPERTY,   // children[0].atom
+        INDEX,      // children[0][children[1]]
+        CALL,       // children[0](children[1], ...)
+        NOT,
+        NEGATE,
+        POSTFIX,    // children[0]++ or children[0]--
+        BINARY,     // Arithmetic and comparison operators
+        SHIFT,      // Shifts children[0] in place by children[1]
+        LOGIC,      // && || & |
+        TERNARY,
+        ASSIGN,     // = += -=
+
+        // Statements
+        EXPRESSION,
+        BLOCK,
+        EMPTY,
+        VAR,        // Children are DECLARATION nodes
+        DECLARATION, // atoms holds the path of "a.b.c", children[0] is the initializer if there is one
+        IF,
+        WHILE,
+        FOR,        // Children are the initializer, condition, iterator and body
+        RETURN,
+        BREAK,
+        CONTINUE,
+        FUNCTION_DECLARATION, // atom is the name, atoms the parameters, children[0] the body and
+                              // string the body source. A body that is compiled on the first call
+                              // is neither parsed nor copied, children and string are empty and
+                              // the body is the [integer, end_position) range of the source.
+    };
+
+    // Syntax tree node, built once per script by Parser
+    class Node {
+    public:
+        NodeKind kind;
+        TokenKind operation = TokenKind::EOS;
+        int position = 0;
+        // Only set for function bodies that are compiled on the first call
+        int end_position = 0;
+        const Atom* atom = nullptr;
+        long long integer = 0;
+        double number = 0;
+        std::string string;
+        std::vector<const Atom*> atoms;
+        std::vector<std::unique_ptr<Node>> children;
+
+        Node(NodeKind kind, int position);
+    };
+
+    // Builds the syntax tree of a script from the lexer tokens
+    class Parser {
+    private:
+        Lexer* lex_;
+        bool lazy_functions_;
+        // Loops around the statement being parsed, within the current function
+        int loop_depth_;
+
+    public:
+        // With lazy_functions, function bodies are only checked for matching brackets and left
+        // to be parsed on the first call
+        Parser(Lexer* lex, bool lazy_functions = true);
+
+        // Parses statements up to the end of the source into a BLOCK node
+        std::unique_ptr<Node> parse_program();
+        std::unique_ptr<Node> parse_statement();
+        std::unique_ptr<Node> parse_block();
+        std::vector<const Atom*> parse_function_arguments();
+
+    private:
+        std::unique_ptr<Node> parse_function_definition();
+        std::unique_ptr<Node> parse_function_call(std::unique_ptr<Node> function);
+        std::unique_ptr<Node> parse_factor();
+        std::unique_ptr<Node> parse_unary();
+        std::unique_ptr<Node> parse_term();
+        std::unique_ptr<Node> parse_expression();
+        std::unique_ptr<Node> parse_shift();
+        std::unique_ptr<Node> parse_condition();
+        std::unique_ptr<Node> parse_logic();
+        std::unique_ptr<Node> parse_ternary();
+        std::unique_ptr<Node> parse_base();
+
+        std::unique_ptr<Node> create_node(NodeKind kind);
+        std::unique_ptr<Node> create_node(NodeKind kind, TokenKind operation, std::unique_ptr<Node> first, std::unique_ptr<Node> second = nullptr);
+        // Replaces operators applied to literals with the literal result
+        std::unique_ptr<Node> fold_constant(std::unique_ptr<Node> node);
+        // Parses a statement that only runs if condition holds, a block that can never run is
+        // skipped without being parsed
+        std::unique_ptr<Node> parse_conditional_statement(const Node* condition, bool run_if);
+    };
+
+    enum class OpCode : unsigned char {
+        PUSH_UNDEFINED,
+        PUSH_NULL,
+        PUSH_CONSTANT,  // Operand indexes Chunk::constants
+        PUSH_FUNCTION,  // Operand indexes Chunk::functions
+        LOAD,           // Operand indexes Chunk::atoms, as do the other name operands
+        GET_PROPERTY,
+        GET_INDEX,
+        CALL,           // Operand is the argument count
+        NOT,
+        NEGATE,
+        POSTFIX,        // Operand is the TokenKind, as for the other operators
+        BINARY,
+        SHIFT,
+        BOOLEAN,        // Non short-circuited side of && and ||
+        JUMP,           // Operand is the target instruction, as for the other jumps
+        JUMP_IF_FALSE,
+        JUMP_IF_FALSE_KEEP, // Short-circuits &&, leaving the condition on the stack
+        JUMP_IF_TRUE_KEEP,  // Short-circuits ||, leaving the condition on the stack
+        PREPARE_ASSIGN,
+        ASSIGN,
+        POP,
+        DECLARE,
+        DECLARE_PROPERTY,
+        INITIALIZE,
+        RETURN,         // Operand is 1 when a value is returned
+        END,
     };
 
     class VariableReference;
     class Variable;
+    class Chunk;
+    class Context;
+
+    // Inline cache of a GET_PROPERTY or GET_INDEX instruction, remembers the slot the property
+    // was in for the last layouts the instruction read from, see Context::find_property
+    struct PropertyCache {
+        struct Entry {
+            // Layout of the object, 0 for an unused entry
+            unsigned long long layout;
+            unsigned int slot;
+            // For properties of the prototype of the object, slot is in the prototype and the
+            // entry holds while the prototype has prototype_layout, which is 0 otherwise
+            unsigned int prototype_slot;
+            unsigned long long prototype_layout;
+        };
+
+        static constexpr size_t size = 4;
+
+        Entry entries[size];
+        // Entry replaced by the next miss
+        size_t next;
+    };
+
+    // x86-64 machine code of a function body that only computes with 32-bit integers: its
+    // parameters, int literals, locals and calls to itself. The code bails out on anything it
+    // can not represent, such as a name read before it is declared, and the call then runs
+    // again in the interpreter, which is safe as such bodies have no side effects.
+    class JitCode {
+    private:
+        void* code_;
+        size_t size_;
+        bool calls_self_;
+        // Bail-outs in a row, shared by every context running the code
+        mutable std::atomic<unsigned int> bail_outs_;
+
+        JitCode(void* code, size_t size, bool calls_self);
+
+    public:
+        static constexpr size_t max_parameters = 16;
+
+        JitCode(const JitCode&) = delete;
+        JitCode& operator=(const JitCode&) = delete;
+        ~JitCode();
+
+        // Returns nullptr if the body uses anything else or the platform is not supported
+        static std::unique_ptr<JitCode> compile(const Chunk& chunk);
+
+        // Set when the body calls the function by its name, the caller has to check the name
+        // resolves to the same function
+        bool calls_self() const;
+        // Returns false if the code bailed out
+        bool run(const int64_t* arguments, int& result) const;
+        // Set once the code bailed out too often in a row, as deep recursion does on every
+        // level, the function then stays in the interpreter
+        bool is_retired() const;
+    };
+
+    // Compiled form of a script or of a function body. Each instruction holds its OpCode in the
+    // low byte and its operand in the upper 24 bits. Every atom also names a frame slot, which
+    // caches the variable the name resolved to for one run of the chunk.
+    class Chunk {
+    public:
+        std::vector<unsigned int> code;
+        std::vector<const Atom*> atoms;
+        // Literal values, pushed without copying. The references are marked as owned so the VM
+        // never frees them, and the values as constant so they are copied before being bound.
+        std::vector<VariableReference*> constants;
+        std::vector<std::shared_ptr<const Chunk>> functions;
+        size_t stack_size = 0;
+        // Keeps the atoms the chunk names alive
+        std::shared_ptr<const AtomTable> atom_table;
+
+        // Set for function bodies, source is empty for lazy ones, see get_source
+        const Atom* name = nullptr;
+        std::vector<const Atom*> parameters;
+        std::string source;
+
+        // Set for function bodies that are compiled on the first call, the body is the
+        // [lazy_begin, lazy_end) range of lazy_source
+        std::shared_ptr<const Source> lazy_source;
+        size_t lazy_begin = 0;
+        size_t lazy_end = 0;
+
+    private:
+        mutable std::once_flag compile_once_;
+        mutable std::shared_ptr<const Chunk> compiled_;
+        mutable std::once_flag jit_once_;
+        mutable std::unique_ptr<JitCode> jit_code_;
+        mutable std::once_flag type_feedback_once_;
+        mutable std::unique_ptr<std::atomic<unsigned char>[]> type_feedback_;
+        mutable std::once_flag property_caches_once_;
+        mutable std::unique_ptr<PropertyCache*[]> property_caches_;
+        mutable std::unique_ptr<PropertyCache[]> property_cache_entries_;
+        mutable std::atomic<const Context*> property_caches_owner_{ nullptr };
+        // Runs of the owner that hold the caches, only touched by the owner
+        mutable size_t property_caches_users_ = 0;
+
+    public:
+        Chunk() = default;
+        Chunk(const Chunk&) = delete;
+        Chunk& operator=(const Chunk&) = delete;
+        ~Chunk();
+
+        // Adds value to the constant pool, marking it constant
+        unsigned int add_constant(Variable* value);
+        // Chunk to run, compiles the body of a lazy chunk on the first call
+        const Chunk* get_compiled() const;
+        // Text of the function body, sliced from lazy_source for a lazy chunk
+        std::string get_source() const;
+        // Machine code of the body, compiled on the first request, nullptr if it has none
+        const JitCode* get_jit_code() const;
+        // Operand types seen by each instruction, indexed like code and shared by every run of
+        // the chunk, see Context::execute_binary
+        std::atomic<unsigned char>* get_type_feedback() const;
+        // Inline cache of each GET_PROPERTY and GET_INDEX instruction, indexed like code. The
+        // caches are not synchronized, so one context holds them at a time: the others get
+        // nullptr until it calls release_property_caches as often as it acquired them.
+        PropertyCache* const* acquire_property_caches(const Context* context) const;
+        void release_property_caches(const Context* context) const;
+    };
+
+    // Turns syntax trees into Chunks
+    class Compiler {
+    private:
+        Chunk* chunk_;
+        std::shared_ptr<const AtomTable> atom_table_;
+        std::shared_ptr<const Source> source_;
+        size_t depth_;
+        std::unordered_map<const Atom*, unsigned int> atom_indices_;
+        std::unordered_map<long long, unsigned int> integer_indices_;
+        std::unordered_map<unsigned long long, unsigned int> float_indices_;
+        std::unordered_map<std::string, unsigned int> string_indices_;
+
+        // Jumps out of a loop body, patched once the loop is compiled
+        struct LoopJumps {
+            std::vector<size_t> breaks;
+            std::vector<size_t> continues;
+        };
+
+        std::vector<LoopJumps> loops_;
+
+    public:
+        // Compiles the statements of a program or of a function body block, the atoms of the
+        // tree have to come from atom_table and its positions from source
+        static std::shared_ptr<Chunk> compile(const Node* block, std::shared_ptr<const AtomTable> atom_table, std::shared_ptr<const Source> source);
+
+    private:
+        Compiler(Chunk* chunk, std::shared_ptr<const AtomTable> atom_table, std::shared_ptr<const Source> source);
+
+        std::shared_ptr<Chunk> compile_function(const Node* definition);
+        void compile_statement(const Node* node);
+        void compile_expression(const Node* node);
+
+        size_t emit(OpCode op, unsigned int operand = 0);
+        void patch(size_t instruction, size_t target);
+        void patch_loop_jumps(size_t continue_target, size_t break_target);
+        unsigned int add_atom(const Atom* atom);
+    };
+
     typedef void (*NativeCallback) (Variable* var, void* data);
 
+    // Key of Variable children, a view of a name owned by a Shape or by the child reference, and
+    // its hash
+    struct VariableKey {
+        std::string_view name;
+        size_t hash;
+
+        bool operator==(const VariableKey& other) const {
+            return hash == other.hash && name == other.name;
+        }
+    };
+
+    struct VariableKeyHash {
+        size_t operator()(const VariableKey& key) const {
+            return key.hash;
+        }
+    };
+
+    // Hidden class of a Variable: the names of its children in the order they were added, the
+    // child of each name is at the same index in the slots of the variable. Shapes form a
+    // transition tree rooted at the empty shape, so variables that get the same names in the
+    // same order share their shape. Shapes are immutable, may be used from any thread and are
+    // never freed, their number is capped instead.
+    class Shape {
+    private:
+        const Shape* parent_;
+        std::string name_;
+        size_t hash_;
+        unsigned int slot_count_;
+        // Unique across shapes and variable layouts, see Variable::get_layout
+        unsigned long long id_;
+        // Shapes one name longer
+        mutable std::mutex transitions_mutex_;
+        mutable std::unordered_map<VariableKey, const Shape*, VariableKeyHash> transitions_;
+        // Slot of every name, built on the first lookup of a long shape
+        mutable std::once_flag table_once_;
+        mutable std::unique_ptr<std::unordered_map<VariableKey, unsigned int, VariableKeyHash>> table_;
+
+        Shape();
+        Shape(const Shape* parent, const std::string& name, size_t hash);
+
+    public:
+        // Variables with more children, or that would need a shape past max_shapes, keep their
+        // own table, see Variable::to_dictionary
+        static constexpr unsigned int max_slots = 64;
+        static constexpr size_t max_shapes = 1 << 16;
+
+        Shape(const Shape&) = delete;
+        Shape& operator=(const Shape&) = delete;
+
+        // Shared by all variables without children, never freed
+        static const Shape* get_empty();
+
+        // Shape with name added, nullptr once there are max_shapes shapes
+        const Shape* add(const std::string& name, size_t hash) const;
+        // Shape without the last name, nullptr for the empty shape
+        const Shape* get_parent() const;
+        // Slot of name, -1 if the shape does not have it
+        int find(std::string_view name, size_t hash) const;
+        unsigned int get_slot_count() const;
+        unsigned long long get_id() const;
+
+        // Source of shape ids and variable layouts
+        static unsigned long long create_id();
+    };
+
     class Variable {
     public:
         enum VariableFlags : unsigned int {
@@ -204,21 +687,29 @@ namespace DeltaScript {
             STRING = 32,
             NULL_ = 64,
             NATIVE = 128,
+            CONSTANT = 256, // Shared literal, never modified in place
             NUMERIC = NULL_ | DOUBLE | INTEGER,
             VARTYPE = DOUBLE | INTEGER | STRING | FUNCTION | OBJECT | ARRAY | NULL_,
         };
 
     protected:
         std::string str_data_;
-        long int_data_;
+        long long int_data_;
         double double_data_;
         unsigned int flags_;
         NativeCallback native_callback_;
         void* native_callback_data_;
+        // Compiled body of script functions, built on the first call for functions created from text
+        std::shared_ptr<const Chunk> function_code_;
     private:
-        std::unordered_map<std::string, VariableReference*> children_;
-        VariableReference* first_child_;
-        VariableReference* last_child_;
+        // Children in the order they were added. The shape maps their names to the index, or
+        // when it is nullptr the dictionary does and removed children leave a nullptr behind.
+        std::vector<VariableReference*> slots_;
+        const Shape* shape_;
+        std::unique_ptr<std::unordered_map<VariableKey, unsigned int, VariableKeyHash>> dictionary_;
+        // Layout of a variable with a dictionary, unique like shape ids and reset to 0 when a
+        // child is added or removed. Assigned on request by get_layout.
+        unsigned long long layout_;
         int ref_count_;
         int execution_count_;
 
@@ -227,7 +718,10 @@ namespace DeltaScript {
         Variable(const std::string& value);
         Variable(const std::string& data, unsigned int var_flags);
         Variable(int value);
+        Variable(long long value);
         Variable(double value);
+        Variable(const Variable&) = delete;
+        Variable& operator=(const Variable&) = delete;
 
         std::string get_string() const;
         bool get_bool() const;
@@ -250,11 +744,16 @@ namespace DeltaScript {
         bool is_undefined() const;
         bool is_null() const;
         bool is_basic() const;
+        bool is_constant() const;
+        void set_constant();
 
         VariableReference* find_child(const std::string& child_name) const;
+        VariableReference* find_child(const Atom& child_name) const;
         VariableReference* find_child_or_create(const std::string& child_name, unsigned int var_flags = VariableFlags::UNDEFINED);
+        VariableReference* find_child_or_create(const Atom& child_name, unsigned int var_flags = VariableFlags::UNDEFINED);
         VariableReference* find_child_or_create_by_path(const std::string& path);
         VariableReference* add_child(const std::string& child_name, Variable* child = nullptr);
+        VariableReference* add_child(const Atom& child_name, Variable* child = nullptr);
         void remove_child(const std::string& child_name, Variable* child, bool throw_if_not_found = false);
         void remove_reference(VariableReference* ref);
         void remove_all_children();
@@ -281,7 +780,20 @@ namespace DeltaScript {
         std::string to_json() const;
         static Variable* from_json(const std::string& string_value);
 
+    private:
+        VariableReference* find_child(std::string_view child_name, size_t hash) const;
+        VariableReference* add_child(const std::string& child_name, size_t hash, Variable* child);
+        // Slot of the child, -1 if there is none
+        int find_slot(std::string_view child_name, size_t hash) const;
+        // Moves the children from the shape to a table of their own
+        void to_dictionary();
+        // Adds copies of the children of value, the variable has none
+        void copy_children_from(const Variable* value);
+        // Identifies which child is in which slot, the shape id or an id of the variable
+        unsigned long long get_layout();
+
         friend class Context;
+        friend class ScriptCache;
     };
 
     class VariableReference {
@@ -291,8 +803,6 @@ namespace DeltaScript {
         VariableReference(const VariableReference& value);
         ~VariableReference();
 
-        VariableReference* next_sibling;
-        VariableReference* prev_sibling;
         Variable* var;
         std::string name;
         bool owner;
@@ -303,42 +813,108 @@ namespace DeltaScript {
         void unreference(Variable* value);
     };
 
+    // Compiled script, holds everything needed to run it without going back to the source text
+    class Script {
+    private:
+        std::shared_ptr<const Source> source_;
+        std::shared_ptr<const Chunk> program_;
+
+    public:
+        Script(std::shared_ptr<const Source> source, std::shared_ptr<const Chunk> program);
+
+        // Runs the script on context, a Script can be run on several contexts at the same time
+        void run(Context& context) const;
+
+        const std::shared_ptr<const Source>& get_source() const;
+        const std::shared_ptr<const Chunk>& get_program() const;
+    };
+
+    // Keeps compiled scripts in a directory, one file per source content and engine version. The
+    // files are read through a memory map and checked against a checksum, an entry that does not
+    // match is compiled again and replaced.
+    class ScriptCache {
+    private:
+        std::string directory_;
+
+    public:
+        ScriptCache(const std::string& directory);
+
+        // Compiled form of source, from the cache if it has a valid entry for it
+        Script get(const Context& context, std::shared_ptr<const Source> source) const;
+        Script get_file(const Context& context, const std::string& path) const;
+
+        // Name of the cache entry of source within the cache directory
+        static std::string get_entry_name(const Source& source);
+
+        static void write(const Script& script, const std::string& path);
+        // Returns nullptr if the file is missing or not a valid entry for source
+        static std::unique_ptr<Script> read(const std::string& path, std::shared_ptr<const Source> source);
+    };
+
     class Context {
     private:
-        Lexer* lex_;
+        // Operand stack entry of the virtual machine, parent is the object a property or index
+        // was read from and becomes "this" when the value is called
+        struct StackValue {
+            VariableReference* ref;
+            Variable* parent;
+        };
+
         std::vector<Variable*> scopes_;
         Variable* root_;
+        std::shared_ptr<AtomTable> atoms_;
+        // Frame slots and operands of the running chunks, see Context::run
+        std::vector<StackValue> stack_;
+        size_t stack_top_;
+        bool jit_enabled_;
+        int jit_threshold_;
+        bool specialization_enabled_;
 
     public:
         Context();
         ~Context();
 
         void execute(const std::string& script);
+        void execute_file(const std::string& path);
+        void execute(std::shared_ptr<const Source> source);
+        void execute(const Script& script);
+        // Lexes, parses and compiles the script once, the result can be run on any Context
+        Script compile(const std::string& script) const;
+        Script compile(std::shared_ptr<const Source> source) const;
+        // Parses the script without executing it, returns the number of top-level statements
+        size_t check_syntax(const std::string& script);
         // VariableReference* evaluate(const std::string& script);
         // std::string evaluate_as_string(const std::string& script);
 
         void add_native_function(const std::string& function_definition, NativeCallback callback, void* data);
 
+        // Functions called at least threshold times run as machine code when their body allows
+        // it, has no effect on builds without DELTASCRIPT_JIT
+        void set_jit_enabled(bool enabled);
+        void set_jit_threshold(int threshold);
+        // Without specialization every instruction takes the generic path, ignoring type
+        // feedback and inline caches, which is slower but gives the same results
+        void set_specialization_enabled(bool enabled);
+
     private:
-        VariableReference* process_function_call(bool& can_execute, VariableReference* function, Variable* parent);
-        VariableReference* process_factor(bool& can_execute);
-        VariableReference* process_unary(bool& can_execute);
-        VariableReference* process_term(bool& can_execute);
-        VariableReference* process_expression(bool& can_execute);
-        VariableReference* process_shift(bool& can_execute);
-        VariableReference* process_condition(bool& can_execute);
-        VariableReference* process_logic(bool& can_execute);
-        VariableReference* process_ternary(bool& can_execute);
-        VariableReference* process_base(bool& can_execute);
-
-        void process_block(bool& can_execute);
-        void process_statement(bool& can_execute);
-
-        VariableReference* parse_function_definition();
-        void parse_function_arguments(Variable* function_variable);
-
-        VariableReference* find_var_in_scopes(const std::string& child_name);
-        VariableReference* find_var_in_parent_classes(Variable* object, const std::string& name);
+        static std::shared_ptr<const Chunk> compile_source(std::shared_ptr<const Source> source, std::shared_ptr<AtomTable> atoms);
+        void execute_program(const Chunk* program);
+
+        // Runs the chunk until it ends or returns
+        void run(const Chunk* chunk);
+        VariableReference* call_function(VariableReference* function, Variable* parent, StackValue* arguments, size_t argument_count);
+        // execute_math_operation with fast paths for the operand types the instruction has seen
+        static Variable* execute_binary(Variable* a, Variable* b, TokenKind operation, std::atomic<unsigned char>& feedback);
+        // Returns nullptr if the function has no machine code or it bailed out
+        VariableReference* call_jit_code(Variable* function, StackValue* arguments, size_t argument_count);
+        Variable* create_function(const std::shared_ptr<const Chunk>& definition);
+
+        VariableReference* find_var_in_scopes(const Atom& child_name);
+        VariableReference* find_var_in_parent_classes(Variable* object, const Atom& name);
+        // Property and index lookups through the inline cache of the instruction, cache may be
+        // nullptr. Neither creates the child.
+        VariableReference* find_property(Variable* object, const Atom& name, PropertyCache* cache);
+        static VariableReference* find_index(Variable* object, const std::string& key, PropertyCache* cache);
     };
 
     namespace Util {
@@ -350,6 +926,22 @@ namespace DeltaScript {
         bool is_digit(char value);
         bool is_number(const std::string& value);
         bool is_hex(char value);
+
+        size_t hash_name(std::string_view name);
+        // FNV-1a, stable between runs and builds
+        uint64_t hash_bytes(const char* data, size_t length, uint64_t hash = 14695981039346656037ULL);
+
+        // Decode numeric literals exactly as the lexer accepts them
+        long long parse_integer_literal(const char* value, size_t length);
+        double parse_float_literal(const char* value, size_t length);
+
+        // Block scanning kernels (SSE2/AVX2 when available), each returns the first position
+        // in [position, end) that stops the scan, or end
+        size_t skip_white_space(const char* source, size_t position, size_t end);
+        size_t skip_identifier(const char* source, size_t position, size_t end);
+        size_t find_line_end(const char* source, size_t position, size_t end);
+        size_t find_multiline_comment_end(const char* source, size_t position, size_t end);
+        size_t find_string_literal_end(const char* source, size_t position, size_t end, char quote);
     }
 }  // namespace DeltaScript
 
@@ -0,0 +1,763 @@
+#include <DeltaScript/DeltaScript.h>
+#include <algorithm>
+#include <cstring>
+
+#if defined(DELTASCRIPT_JIT) && defined(__x86_64__) && defined(__linux__)
+#define DELTASCRIPT_JIT_X86_64
+#include <sys/mman.h>
+#endif
+
+namespace DeltaScript {
+    namespace {
+        // Each interpreted level of a recursion too deep for the code enters it again and bails
+        // out once more, after this many bail-outs in a row the code is no longer entered
+        const unsigned int max_bail_outs = 16;
+    }
+
+#ifdef DELTASCRIPT_JIT_X86_64
+    namespace {
+        // Native recursion bails out before its frames take more than max_stack_bytes, or
+        // after max_call_depth calls of small frames, and the interpreter runs the call instead
+        const int max_call_depth = 4096;
+        const size_t max_stack_bytes = 256 * 1024;
+        const size_t max_frame_slots = 1024;
+        // Return address and the rbp, rbx and r12 the prologue pushes
+        const size_t saved_bytes = 32;
+
+        enum Register : unsigned char {
+            EAX = 0,
+            ECX = 1,
+            EDX = 2,
+        };
+
+        enum Condition : unsigned char {
+            ALWAYS = 0,
+            EQUAL = 0x84,
+            NOT_EQUAL = 0x85,
+            ABOVE = 0x87,
+        };
+
+        // Frame slots are 8 bytes wide and addressed from rsp, values live in their low 4 bytes
+        class Assembler {
+        public:
+            std::vector<unsigned char> code;
+
+            void emit(std::initializer_list<unsigned char> bytes) {
+                code.insert(code.end(), bytes);
+            }
+
+            void emit_int(int32_t value) {
+                for (int i = 0; i < 4; ++i)
+                    code.push_back((unsigned char)((uint32_t)value >> (i * 8)));
+            }
+
+            // mov reg, [rsp + slot * 8]
+            void load(Register reg, size_t slot) {
+                emit({ 0x8B, (unsigned char)(0x84 | reg << 3), 0x24 });
+                emit_int((int32_t)(slot * 8));
+            }
+
+            // mov [rsp + slot * 8], reg
+            void store(size_t slot, Register reg) {
+                emit({ 0x89, (unsigned char)(0x84 | reg << 3), 0x24 });
+                emit_int((int32_t)(slot * 8));
+            }
+
+            // mov dword [rsp + slot * 8], value
+            void store_immediate(size_t slot, int32_t value) {
+                emit({ 0xC7, 0x84, 0x24 });
+                emit_int((int32_t)(slot * 8));
+                emit_int(value);
+            }
+
+            // cmp dword [rsp + slot * 8], value
+            void compare_immediate(size_t slot, int32_t value) {
+                emit({ 0x81, 0xBC, 0x24 });
+                emit_int((int32_t)(slot * 8));
+                emit_int(value);
+            }
+
+            // setcc al; movzx eax, al
+            void set_flag(unsigned char condition) {
+                emit({ 0x0F, condition, 0xC0, 0x0F, 0xB6, 0xC0 });
+            }
+
+            // Returns the position of the rel32 to patch
+            size_t jump(Condition condition) {
+                if (condition == Condition::ALWAYS)
+                    emit({ 0xE9 });
+                else
+                    emit({ 0x0F, condition });
+
+                emit_int(0);
+
+                return code.size() - 4;
+            }
+
+            size_t call() {
+                emit({ 0xE8 });
+                emit_int(0);
+
+                return code.size() - 4;
+            }
+
+            void patch(size_t position, size_t target) {
+                int32_t offset = (int32_t)target - (int32_t)(position + 4);
+                std::memcpy(&code[position], &offset, 4);
+            }
+
+            void emit_epilogue() {
+                // lea rsp, [rbp - 16]; pop r12; pop rbx; pop rbp; ret
+                emit({ 0x48, 0x8D, 0x65, 0xF0, 0x41, 0x5C, 0x5B, 0x5D, 0xC3 });
+            }
+        };
+
+        // Translates a chunk instruction by instruction. The operand stack is tracked while
+        // translating: an entry is either a value in its frame slot, a local that is read when
+        // the entry is used, as the interpreter reads through the reference, or the function
+        // itself about to be called. Entries are stored to their slots before every jump so
+        // both sides of a jump agree on where the values are.
+        //
+        // The code is entered as int code(const int64_t* arguments, int* result, int depth)
+        // and returns 0 once it stored the result, 1 when it bailed out.
+        class Translator {
+        private:
+            struct StackEntry {
+                enum Kind {
+                    VALUE,
+                    LOCAL,
+                    SELF,
+                } kind;
+                size_t local;
+            };
+
+            static constexpr size_t unset = (size_t)-1;
+            static constexpr size_t bail_out_target = (size_t)-1;
+
+            const Chunk& chunk_;
+            Assembler assembler_;
+            // Parameters first, then the names the body declares, which need a flag slot as
+            // reading them before their declaration resolves to another scope
+            std::vector<std::string> locals_;
+            size_t parameter_count_;
+            size_t operand_base_;
+            std::vector<StackEntry> stack_;
+            std::vector<size_t> label_depths_;
+            std::vector<size_t> label_offsets_;
+            std::vector<std::pair<size_t, size_t>> jumps_;
+            std::vector<size_t> calls_;
+            bool calls_self_;
+
+        public:
+            Translator(const Chunk& chunk) : chunk_(chunk), parameter_count_(0), operand_base_(0), calls_self_(false) {}
+
+            bool calls_self() const {
+                return calls_self_;
+            }
+
+            const std::vector<unsigned char>& get_code() const {
+                return assembler_.code;
+            }
+
+            bool translate() {
+                const std::vector<unsigned int>& code = chunk_.code;
+
+                if (chunk_.parameters.size() > JitCode::max_parameters)
+                    return false;
+
+                for (const Atom* parameter : chunk_.parameters) {
+                    if (find_local(parameter->name) != unset)
+                        return false;
+
+                    locals_.push_back(parameter->name);
+                }
+
+                parameter_count_ = locals_.size();
+
+                for (unsigned int instruction : code) {
+                    OpCode op = (OpCode)(instruction & 0xFF);
+                    unsigned int operand = instruction >> 8;
+
+                    if (op == OpCode::DECLARE && find_local(chunk_.atoms[operand]->name) == unset)
+                        locals_.push_back(chunk_.atoms[operand]->name);
+
+                    if ((op == OpCode::JUMP || op == OpCode::JUMP_IF_FALSE || op == OpCode::JUMP_IF_FALSE_KEEP
+                        || op == OpCode::JUMP_IF_TRUE_KEEP) && operand >= code.size())
+                        return false;
+                }
+
+                operand_base_ = locals_.size() * 2 - parameter_count_;
+                size_t slot_count = operand_base_ + chunk_.stack_size;
+
+                if (slot_count > max_frame_slots)
+                    return false;
+
+                std::vector<bool> is_label(code.size(), false);
+
+                for (unsigned int instruction : code) {
+                    OpCode op = (OpCode)(instruction & 0xFF);
+
+                    if (op == OpCode::JUMP || op == OpCode::JUMP_IF_FALSE || op == OpCode::JUMP_IF_FALSE_KEEP
+                        || op == OpCode::JUMP_IF_TRUE_KEEP)
+                        is_label[instruction >> 8] = true;
+                }
+
+                label_depths_.assign(code.size(), unset);
+                label_offsets_.assign(code.size(), unset);
+
+                emit_prologue((slot_count * 8 + 15) & ~(size_t)15);
+
+                bool reachable = true;
+
+                for (size_t ip = 0; ip < code.size(); ++ip) {
+                    if (is_label[ip]) {
+                        if (reachable) {
+                            if (!flush() || (label_depths_[ip] != unset && label_depths_[ip] != stack_.size()))
+                                return false;
+
+                            label_depths_[ip] = stack_.size();
+                        }
+                        else if (label_depths_[ip] != unset) {
+                            stack_.assign(label_depths_[ip], StackEntry{ StackEntry::VALUE, 0 });
+                            reachable = true;
+                        }
+
+                        if (reachable)
+                            label_offsets_[ip] = assembler_.code.size();
+                    }
+
+                    // Code after a return or a jump that no jump leads to is left out
+                    if (!reachable)
+                        continue;
+
+                    if (!translate_instruction(ip, reachable))
+                        return false;
+                }
+
+                size_t bail_out = assembler_.code.size();
+
+                // mov eax, 1
+                assembler_.emit({ 0xB8 });
+                assembler_.emit_int(1);
+                assembler_.emit_epilogue();
+
+                for (const std::pair<size_t, size_t>& jump : jumps_) {
+                    size_t target = jump.second == bail_out_target ? bail_out : label_offsets_[jump.second];
+
+                    if (target == unset)
+                        return false;
+
+                    assembler_.patch(jump.first, target);
+                }
+
+                for (size_t call : calls_)
+                    assembler_.patch(call, 0);
+
+                return true;
+            }
+
+        private:
+            size_t find_local(const std::string& name) const {
+                for (size_t i = 0; i < locals_.size(); ++i) {
+                    if (locals_[i] == name)
+                        return i;
+                }
+
+                return unset;
+            }
+
+            size_t get_flag_slot(size_t local) const {
+                return locals_.size() + local - parameter_count_;
+            }
+
+            size_t get_operand_slot(size_t position) const {
+                return operand_base_ + position;
+            }
+
+            void bail_out_if(Condition condition) {
+                jumps_.emplace_back(assembler_.jump(condition), bail_out_target);
+            }
+
+            bool jump_to(size_t target, Condition condition, size_t ip) {
+                // Backward jumps lead to loop conditions, which the code falls through to first
+                if (target <= ip && label_offsets_[target] == unset)
+                    return false;
+
+                if (label_depths_[target] != unset && label_depths_[target] != stack_.size())
+                    return false;
+
+                label_depths_[target] = stack_.size();
+                jumps_.emplace_back(assembler_.jump(condition), target);
+
+                return true;
+            }
+
+            void emit_prologue(size_t frame_size) {
+                // push rbp; mov rbp, rsp; push rbx; push r12; sub rsp, frame_size
+                assembler_.emit({ 0x55, 0x48, 0x89, 0xE5, 0x53, 0x41, 0x54, 0x48, 0x81, 0xEC });
+                assembler_.emit_int((int32_t)frame_size);
+                // mov ebx, edx; mov r12, rsi
+                assembler_.emit({ 0x89, 0xD3, 0x49, 0x89, 0xF4 });
+                // cmp ebx, last depth that fits in the budget
+                size_t max_depth = std::min<size_t>(max_call_depth, max_stack_bytes / (frame_size + saved_bytes));
+                assembler_.emit({ 0x81, 0xFB });
+                assembler_.emit_int((int32_t)max_depth - 1);
+                bail_out_if(Condition::ABOVE);
+
+                for (size_t i = 0; i < parameter_count_; ++i) {
+                    // mov eax, [rdi + i * 8]
+                    assembler_.emit({ 0x8B, 0x87 });
+                    assembler_.emit_int((int32_t)(i * 8));
+                    assembler_.store(i, Register::EAX);
+                }
+
+                for (size_t i = parameter_count_; i < locals_.size(); ++i)
+                    assembler_.store_immediate(get_flag_slot(i), 0);
+            }
+
+            // Stores every entry to its slot, the function itself has no slot value
+            bool flush() {
+                for (size_t i = 0; i < stack_.size(); ++i) {
+                    if (stack_[i].kind == StackEntry::SELF)
+                        return false;
+
+                    if (stack_[i].kind == StackEntry::LOCAL) {
+                        assembler_.load(Register::EDX, stack_[i].local);
+                        assembler_.store(get_operand_slot(i), Register::EDX);
+                        stack_[i].kind = StackEntry::VALUE;
+                    }
+                }
+
+                return true;
+            }
+
+            bool load(Register reg, size_t position) {
+                const StackEntry& entry = stack_[position];
+
+                if (entry.kind == StackEntry::SELF)
+                    return false;
+
+                assembler_.load(reg, entry.kind == StackEntry::LOCAL ? entry.local : get_operand_slot(position));
+
+                return true;
+            }
+
+            // Replaces the top entry with the value in eax
+            void store_result() {
+                assembler_.store(get_operand_slot(stack_.size() - 1), Register::EAX);
+                stack_.back().kind = StackEntry::VALUE;
+            }
+
+            bool translate_binary(TokenKind operation) {
+                switch (operation) {
+                case TokenKind::PLUS_P:
+                    assembler_.emit({ 0x01, 0xC8 });
+                    break;
+                case TokenKind::MINUS_P:
+                    assembler_.emit({ 0x29, 0xC8 });
+                    break;
+                case TokenKind::MUL_P:
+                    assembler_.emit({ 0x0F, 0xAF, 0xC1 });
+                    break;
+                case TokenKind::BIT_AND_P:
+                    assembler_.emit({ 0x21, 0xC8 });
+                    break;
+                case TokenKind::BIT_OR_P:
+                    assembler_.emit({ 0x09, 0xC8 });
+                    break;
+                case TokenKind::BIT_XOR_P:
+                    assembler_.emit({ 0x31, 0xC8 });
+                    break;
+                case TokenKind::DIV_P:
+                case TokenKind::MOD_P:
+                    // Division by zero and INT_MIN / -1 trap, the interpreter has to report them
+                    assembler_.emit({ 0x85, 0xC9 });
+                    bail_out_if(Condition::EQUAL);
+                    // cmp ecx, -1; jne over the next check; cmp eax, INT_MIN
+                    assembler_.emit({ 0x83, 0xF9, 0xFF, 0x75, 0x0B, 0x3D, 0x00, 0x00, 0x00, 0x80 });
+                    bail_out_if(Condition::EQUAL);
+                    // cdq; idiv ecx
+                    assembler_.emit({ 0x99, 0xF7, 0xF9 });
+
+                    if (operation == TokenKind::MOD_P)
+                        assembler_.emit({ 0x89, 0xD0 });
+
+                    break;
+                case TokenKind::EQUAL_P:
+                case TokenKind::STRICT_EQUAL_P:
+                    assembler_.emit({ 0x39, 0xC8 });
+                    assembler_.set_flag(0x94);
+                    break;
+                case TokenKind::NEQUAL_P:
+                case TokenKind::STRICT_NEQUAL_P:
+                    assembler_.emit({ 0x39, 0xC8 });
+                    assembler_.set_flag(0x95);
+                    break;
+                case TokenKind::LT_P:
+                    assembler_.emit({ 0x39, 0xC8 });
+                    assembler_.set_flag(0x9C);
+                    break;
+                case TokenKind::LTE_P:
+                    assembler_.emit({ 0x39, 0xC8 });
+                    assembler_.set_flag(0x9E);
+                    break;
+                case TokenKind::GT_P:
+                    assembler_.emit({ 0x39, 0xC8 });
+                    assembler_.set_flag(0x9F);
+                    break;
+                case TokenKind::GTE_P:
+                    assembler_.emit({ 0x39, 0xC8 });
+                    assembler_.set_flag(0x9D);
+                    break;
+                default:
+                    return false;
+                }
+
+                return true;
+            }
+
+            // Writes to locals are only translated as whole statements, so no entry that
+            // reads the local can be left on the stack when it changes
+            bool translate_instruction(size_t ip, bool& reachable) {
+                OpCode op = (OpCode)(chunk_.code[ip] & 0xFF);
+                unsigned int operand = chunk_.code[ip] >> 8;
+                size_t depth = stack_.size();
+
+                switch (op) {
+                case OpCode::PUSH_CONSTANT: {
+                    const Variable* value = chunk_.constants[operand]->var;
+
+                    // Integer literals outside of 32 bits keep their full value in the interpreter
+                    if (!value->is_int() || value->get_double() != (double)value->get_int())
+                        return false;
+
+                    assembler_.store_immediate(get_operand_slot(depth), value->get_int());
+                    stack_.push_back(StackEntry{ StackEntry::VALUE, 0 });
+                    break;
+                }
+
+                case OpCode::LOAD: {
+                    const std::string& name = chunk_.atoms[operand]->name;
+                    size_t local = find_local(name);
+
+                    if (local != unset) {
+                        if (local >= parameter_count_) {
+                            assembler_.compare_immediate(get_flag_slot(local), 0);
+                            bail_out_if(Condition::EQUAL);
+                        }
+
+                        stack_.push_back(StackEntry{ StackEntry::LOCAL, local });
+                    }
+                    else if (chunk_.name && chunk_.name->name == name) {
+                        calls_self_ = true;
+                        stack_.push_back(StackEntry{ StackEntry::SELF, 0 });
+                    }
+                    else {
+                        return false;
+                    }
+
+                    break;
+                }
+
+                case OpCode::CALL: {
+                    if (depth < (size_t)operand + 1 || operand != parameter_count_)
+                        return false;
+
+                    size_t function = depth - operand - 1;
+
+                    if (stack_[function].kind != StackEntry::SELF)
+                        return false;
+
+                    for (size_t i = function + 1; i < depth; ++i) {
+                        if (stack_[i].kind == StackEntry::SELF)
+                            return false;
+
+                        if (stack_[i].kind == StackEntry::LOCAL) {
+                            assembler_.load(Register::EDX, stack_[i].local);
+                            assembler_.store(get_operand_slot(i), Register::EDX);
+                        }
+                    }
+
+                    // lea rdi, [rsp + arguments]; lea rsi, [rsp + function]; lea edx, [rbx + 1]
+                    assembler_.emit({ 0x48, 0x8D, 0xBC, 0x24 });
+                    assembler_.emit_int((int32_t)(get_operand_slot(function + 1) * 8));
+                    assembler_.emit({ 0x48, 0x8D, 0xB4, 0x24 });
+                    assembler_.emit_int((int32_t)(get_operand_slot(function) * 8));
+                    assembler_.emit({ 0x8D, 0x53, 0x01 });
+                    calls_.push_back(assembler_.call());
+                    // test eax, eax
+                    assembler_.emit({ 0x85, 0xC0 });
+                    bail_out_if(Condition::NOT_EQUAL);
+
+                    stack_.resize(function + 1);
+                    stack_.back().kind = StackEntry::VALUE;
+                    break;
+                }
+
+                case OpCode::NOT:
+                    if (depth < 1 || !load(Register::EAX, depth - 1))
+                        return false;
+
+                    // test eax, eax; sete al
+                    assembler_.emit({ 0x85, 0xC0 });
+                    assembler_.set_flag(0x94);
+                    store_result();
+                    break;
+
+                case OpCode::NEGATE:
+                    if (depth < 1 || !load(Register::EAX, depth - 1))
+                        return false;
+
+                    // neg eax
+                    assembler_.emit({ 0xF7, 0xD8 });
+                    store_result();
+                    break;
+
+                case OpCode::POSTFIX: {
+                    if (depth < 1 || stack_.back().kind == StackEntry::SELF)
+                        return false;
+
+                    // A temporary is incremented and dropped, its old value is the same value
+                    if (stack_.back().kind == StackEntry::VALUE)
+                        break;
+
+                    if (depth != 1)
+                        return false;
+
+                    size_t local = stack_.back().local;
+                    assembler_.load(Register::EAX, local);
+                    assembler_.store(get_operand_slot(0), Register::EAX);
+
+                    // add eax, 1 or sub eax, 1
+                    if ((TokenKind)operand == TokenKind::INCR_P)
+                        assembler_.emit({ 0x83, 0xC0, 0x01 });
+                    else
+                        assembler_.emit({ 0x83, 0xE8, 0x01 });
+
+                    assembler_.store(local, Register::EAX);
+                    stack_.back().kind = StackEntry::VALUE;
+                    break;
+                }
+
+                case OpCode::BINARY:
+                    if (depth < 2 || !load(Register::EAX, depth - 2) || !load(Register::ECX, depth - 1)
+                        || !translate_binary((TokenKind)operand))
+                        return false;
+
+                    stack_.pop_back();
+                    store_result();
+                    break;
+
+                case OpCode::BOOLEAN: {
+                    if ((TokenKind)operand != TokenKind::BIT_AND_P && (TokenKind)operand != TokenKind::BIT_OR_P)
+                        return false;
+
+                    if (depth < 2 || !load(Register::EAX, depth - 2) || !load(Register::ECX, depth - 1))
+                        return false;
+
+                    // test eax, eax; setne al; movzx eax, al; test ecx, ecx; setne cl; movzx ecx, cl
+                    assembler_.emit({ 0x85, 0xC0 });
+                    assembler_.set_flag(0x95);
+                    assembler_.emit({ 0x85, 0xC9, 0x0F, 0x95, 0xC1, 0x0F, 0xB6, 0xC9 });
+                    translate_binary((TokenKind)operand);
+
+                    stack_.pop_back();
+                    store_result();
+                    break;
+                }
+
+                case OpCode::JUMP:
+                    if (!flush() || !jump_to(operand, Condition::ALWAYS, ip))
+                        return false;
+
+                    reachable = false;
+                    break;
+
+                case OpCode::JUMP_IF_FALSE:
+                    if (depth < 1 || !load(Register::EAX, depth - 1))
+                        return false;
+
+                    stack_.pop_back();
+
+                    if (!flush())
+                        return false;
+
+                    // test eax, eax
+                    assembler_.emit({ 0x85, 0xC0 });
+
+                    if (!jump_to(operand, Condition::EQUAL, ip))
+                        return false;
+
+                    break;
+
+                case OpCode::JUMP_IF_FALSE_KEEP:
+                case OpCode::JUMP_IF_TRUE_KEEP:
+                    if (depth < 1 || !flush())
+                        return false;
+
+                    load(Register::EAX, depth - 1);
+                    assembler_.emit({ 0x85, 0xC0 });
+
+                    if (!jump_to(operand, op == OpCode::JUMP_IF_FALSE_KEEP ? Condition::EQUAL : Condition::NOT_EQUAL, ip))
+                        return false;
+
+                    break;
+
+                case OpCode::PREPARE_ASSIGN:
+                    // Anything else is not a name of this function or throws
+                    if (depth < 1 || stack_.back().kind != StackEntry::LOCAL)
+                        return false;
+
+                    break;
+
+                case OpCode::ASSIGN: {
+                    if (depth != 2 || stack_[0].kind != StackEntry::LOCAL)
+                        return false;
+
+                    size_t local = stack_[0].local;
+
+                    if ((TokenKind)operand == TokenKind::ASSIGN_P) {
+                        if (!load(Register::EAX, 1))
+                            return false;
+                    }
+                    else if ((TokenKind)operand == TokenKind::PLUS_EQ_P || (TokenKind)operand == TokenKind::MINUS_EQ_P) {
+                        assembler_.load(Register::EAX, local);
+
+                        if (!load(Register::ECX, 1))
+                            return false;
+
+                        translate_binary((TokenKind)operand == TokenKind::PLUS_EQ_P ? TokenKind::PLUS_P : TokenKind::MINUS_P);
+                    }
+                    else {
+                        return false;
+                    }
+
+                    assembler_.store(local, Register::EAX);
+                    stack_.pop_back();
+                    break;
+                }
+
+                case OpCode::POP:
+                    if (depth < 1)
+                        return false;
+
+                    stack_.pop_back();
+                    break;
+
+                case OpCode::DECLARE: {
+                    // A declaration without a value leaves the name undefined
+                    if (depth != 0 || ip + 1 >= chunk_.code.size() || (OpCode)(chunk_.code[ip + 1] & 0xFF) == OpCode::POP)
+                        return false;
+
+                    size_t local = find_local(chunk_.atoms[operand]->name);
+
+                    if (local >= parameter_count_)
+                        assembler_.store_immediate(get_flag_slot(local), 1);
+
+                    stack_.push_back(StackEntry{ StackEntry::LOCAL, local });
+                    break;
+                }
+
+                case OpCode::INITIALIZE:
+                    if (depth != 2 || stack_[0].kind != StackEntry::LOCAL || !load(Register::EAX, 1))
+                        return false;
+
+                    assembler_.store(stack_[0].local, Register::EAX);
+                    stack_.pop_back();
+                    break;
+
+                case OpCode::RETURN:
+                    // Returning undefined is left to the interpreter
+                    if (!operand || depth < 1 || !load(Register::EAX, depth - 1))
+                        return false;
+
+                    // mov [r12], eax; xor eax, eax
+                    assembler_.emit({ 0x41, 0x89, 0x04, 0x24, 0x31, 0xC0 });
+                    assembler_.emit_epilogue();
+
+                    stack_.pop_back();
+                    reachable = false;
+                    break;
+
+                case OpCode::END:
+                    bail_out_if(Condition::ALWAYS);
+                    reachable = false;
+                    break;
+
+                default:
+                    return false;
+                }
+
+                return true;
+            }
+        };
+    }
+#endif
+
+    JitCode::JitCode(void* code, size_t size, bool calls_self) : code_(code), size_(size), calls_self_(calls_self), bail_outs_(0) {
+
+    }
+
+    JitCode::~JitCode() {
+#ifdef DELTASCRIPT_JIT_X86_64
+        munmap(code_, size_);
+#endif
+    }
+
+    std::unique_ptr<JitCode> JitCode::compile(const Chunk& chunk) {
+#ifdef DELTASCRIPT_JIT_X86_64
+        Translator translator(chunk);
+
+        if (!translator.translate())
+            return nullptr;
+
+        const std::vector<unsigned char>& code = translator.get_code();
+
+        // Pages are never writable and executable at the same time
+        void* memory = mmap(nullptr, code.size(), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+        if (memory == MAP_FAILED)
+            return nullptr;
+
+        std::memcpy(memory, code.data(), code.size());
+
+        if (mprotect(memory, code.size(), PROT_READ | PROT_EXEC) != 0) {
+            munmap(memory, code.size());
+
+            return nullptr;
+        }
+
+        return std::unique_ptr<JitCode>(new JitCode(memory, code.size(), translator.calls_self()));
+#else
+        (void)chunk;
+
+        return nullptr;
+#endif
+    }
+
+    bool JitCode::calls_self() const {
+        return calls_self_;
+    }
+
+    bool JitCode::run(const int64_t* arguments, int& result) const {
+        typedef int (*Entry)(const int64_t* arguments, int* result, int depth);
+
+        if (((Entry)code_)(arguments, &result, 0) != 0) {
+            bail_outs_.fetch_add(1, std::memory_order_relaxed);
+
+            return false;
+        }
+
+        // Only stores when there is something to reset, so hot calls do not write shared memory
+        unsigned int bail_outs = bail_outs_.load(std::memory_order_relaxed);
+
+        if (bail_outs != 0 && bail_outs < max_bail_outs)
+            bail_outs_.store(0, std::memory_order_relaxed);
+
+        return true;
+    }
+
+    bool JitCode::is_retired() const {
+        return bail_outs_.load(std::memory_order_relaxed) >= max_bail_outs;
+    }
+}  // namespace DeltaScript
@@ -2,59 +2,232 @@
 #include <sstream>
 
 namespace DeltaScript {
+    namespace {
+        size_t get_bracket_type(TokenKind kind) {
+            switch (kind) {
+            case TokenKind::LBRACE_P:
+            case TokenKind::RBRACE_P:
+                return 0;
+            case TokenKind::LPAREN_P:
+            case TokenKind::RPAREN_P:
+                return 1;
+            default:
+                return 2;
+            }
+        }
+    }
+
     LexerException::LexerException(const std::string& message) : DeltaScriptException(message) {
 
     }
 
-    Lexer::Lexer(const std::string& source) {
-        source_ = new char[source.size() + 1];
-        std::copy(source.begin(), source.end(), source_);
-        source_[source.size()] = '\0';
+    Lexer::Lexer(const std::string& source, AtomTable* atoms) : Lexer(Source::from_string(source), atoms) {
 
-        source_owner = true;
-        source_start_ = 0;
-        source_end_ = source.length();
+    }
+
+    Lexer::Lexer(std::shared_ptr<const Source> source, AtomTable* atoms) : Lexer(source, 0, source->size(), atoms) {
 
-        reset();
     }
 
-    Lexer::Lexer(Lexer* parent, int source_start, int source_end) {
-        source_ = parent->source_;
+    Lexer::Lexer(std::shared_ptr<const Source> source, size_t begin, size_t end, AtomTable* atoms) : source_buffer_(std::move(source)) {
+        source_ = source_buffer_->data();
+        source_begin_ = begin < source_buffer_->size() ? begin : source_buffer_->size();
+        source_end_ = end < source_buffer_->size() ? end : source_buffer_->size();
+
+        atoms_ = atoms;
 
-        source_owner = false;
-        source_start_ = source_start;
-        source_end_ = source_end;
+        if (!atoms_) {
+            own_atoms_.reset(new AtomTable());
+            atoms_ = own_atoms_.get();
+        }
 
+        tokenize();
         reset();
     }
 
-    Lexer::~Lexer() {
-        if (source_owner)
-            delete[] source_;
+    void Lexer::tokenize() {
+        // Open brackets waiting for their closing bracket, and how many of each kind there are
+        std::vector<int> open_brackets;
+        size_t open_counts[3] = { 0, 0, 0 };
+
+        c_source_position_ = (int)source_begin_;
+
+        get_next_char();
+        get_next_char();
+
+        do {
+            scan_next_token();
+
+            Token token;
+            token.kind = c_token_kind;
+            token.start = c_token_start;
+            token.end = c_source_position_ - 2 < (int)source_end_ ? c_source_position_ - 2 : (int)source_end_;
+            token.value = -1;
+
+            if (c_token_kind == TokenKind::IDENTIFIER) {
+                token.value = atoms_->intern(std::string_view(&source_[token.start], token.end - token.start));
+            }
+            else if (c_token_kind == TokenKind::INTEGER_L) {
+                token.value = (int)token_integers_.size();
+                token_integers_.push_back(Util::parse_integer_literal(&source_[token.start], token.end - token.start));
+            }
+            else if (c_token_kind == TokenKind::FLOAT_L) {
+                token.value = (int)token_floats_.size();
+                token_floats_.push_back(Util::parse_float_literal(&source_[token.start], token.end - token.start));
+            }
+            else if (c_token_materialized) {
+                token.value = (int)token_values_.size();
+                token_values_.push_back(c_token_value);
+            }
+            else if (c_token_kind == TokenKind::LBRACE_P || c_token_kind == TokenKind::LPAREN_P
+                || c_token_kind == TokenKind::LBRACK_P) {
+                open_brackets.push_back((int)tokens_.size());
+                ++open_counts[get_bracket_type(c_token_kind)];
+            }
+            else if (c_token_kind == TokenKind::RBRACE_P || c_token_kind == TokenKind::RPAREN_P
+                || c_token_kind == TokenKind::RBRACK_P) {
+                TokenKind opening = c_token_kind == TokenKind::RBRACE_P ? TokenKind::LBRACE_P
+                    : c_token_kind == TokenKind::RPAREN_P ? TokenKind::LPAREN_P : TokenKind::LBRACK_P;
+
+                // Brackets left open inside the pair stay unmatched, as does a stray closing
+                // bracket, the parser reports them
+                if (open_counts[get_bracket_type(opening)] > 0) {
+                    while (tokens_[open_brackets.back()].kind != opening) {
+                        --open_counts[get_bracket_type(tokens_[open_brackets.back()].kind)];
+                        open_brackets.pop_back();
+                    }
+
+                    token.value = open_brackets.back();
+                    tokens_[open_brackets.back()].value = (int)tokens_.size();
+                    --open_counts[get_bracket_type(opening)];
+                    open_brackets.pop_back();
+                }
+            }
+
+            tokens_.push_back(token);
+        } while (c_token_kind != TokenKind::EOS);
+
+        c_token_value.clear();
     }
 
     void Lexer::reset() {
-        c_source_position_ = source_start_;
+        seek(0);
+    }
 
-        c_token_start = 0;
-        c_token_end = 0;
-        p_token_end = 0;
+    void Lexer::seek(size_t token_index) {
+        if (token_index >= tokens_.size())
+            token_index = tokens_.size() - 1;
 
-        c_token_kind = TokenKind::EOS;
-        c_token_value = "";
+        c_token_index_ = token_index;
 
-        get_next_char();
-        get_next_char();
-
-        parse_next_token();
+        const Token& token = tokens_[c_token_index_];
+        c_token_kind = token.kind;
+        c_token_start = token.start;
     }
-    
+
     TokenKind Lexer::get_current_token() const {
         return c_token_kind;
     }
 
     std::string Lexer::get_token_value() const {
-        return c_token_value;
+        return std::string(get_token_view());
+    }
+
+    std::string_view Lexer::get_token_view() const {
+        const Token& token = tokens_[c_token_index_];
+
+        if (token.value >= 0 && token.kind == TokenKind::STRING_L)
+            return token_values_[token.value];
+
+        if (token.kind == TokenKind::STRING_L) {
+            int value_end = token.end;
+
+            if (value_end - 1 > token.start && source_[value_end - 1] == source_[token.start])
+                --value_end;
+
+            return std::string_view(&source_[token.start + 1], value_end - token.start - 1);
+        }
+
+        if ((token.kind >= TokenKind::IDENTIFIER && token.kind <= TokenKind::YIELD_K)
+            || token.kind == TokenKind::INTEGER_L || token.kind == TokenKind::FLOAT_L)
+            return std::string_view(&source_[token.start], token.end - token.start);
+
+        return std::string_view();
+    }
+
+    const Atom& Lexer::get_token_atom() const {
+        return atoms_->get(get_token_atom_id());
+    }
+
+    int Lexer::get_token_atom_id() const {
+        const Token& token = tokens_[c_token_index_];
+
+        if (token.kind != TokenKind::IDENTIFIER)
+            throw LexerException("Expected " + Token::get_token_kind_as_string(TokenKind::IDENTIFIER)
+                + ", got " + Token::get_token_kind_as_string(token.kind) + " at " + get_position_info(token.start));
+
+        return token.value;
+    }
+
+    long long Lexer::get_token_integer() const {
+        const Token& token = tokens_[c_token_index_];
+
+        if (token.kind == TokenKind::INTEGER_L)
+            return token_integers_[token.value];
+
+        if (token.kind == TokenKind::FLOAT_L)
+            return (long long)token_floats_[token.value];
+
+        return 0;
+    }
+
+    double Lexer::get_token_float() const {
+        const Token& token = tokens_[c_token_index_];
+
+        if (token.kind == TokenKind::FLOAT_L)
+            return token_floats_[token.value];
+
+        if (token.kind == TokenKind::INTEGER_L)
+            return (double)token_integers_[token.value];
+
+        return 0;
+    }
+
+    const std::shared_ptr<const Source>& Lexer::get_source() const {
+        return source_buffer_;
+    }
+
+    size_t Lexer::get_token_count() const {
+        return tokens_.size();
+    }
+
+    int Lexer::get_matching_token(size_t token_index) const {
+        if (token_index >= tokens_.size())
+            return -1;
+
+        switch (tokens_[token_index].kind) {
+        case TokenKind::LBRACE_P:
+        case TokenKind::LPAREN_P:
+        case TokenKind::LBRACK_P:
+        case TokenKind::RBRACE_P:
+        case TokenKind::RPAREN_P:
+        case TokenKind::RBRACK_P:
+            return tokens_[token_index].value;
+        default:
+            return -1;
+        }
+    }
+
+    const LineIndex& Lexer::get_line_index() const {
+        return source_buffer_->get_line_index();
+    }
+
+    std::string Lexer::get_position_info(int position) const {
+        return get_line_index().get_position_info(position);
+    }
+
+    size_t Lexer::get_token_index() const {
+        return c_token_index_;
     }
 
     void Lexer::expect_and_get_next(TokenKind expected_kind) {
@@ -62,7 +235,7 @@ namespace DeltaScript {
             std::ostringstream msg;
             msg << "Expected " << Token::get_token_kind_as_string(expected_kind)
                 << ", got " << Token::get_token_kind_as_string(c_token_kind)
-                << " at " << Token::get_position_info(source_, source_end_, c_token_start);
+                << " at " << get_position_info(c_token_start);
 
             throw LexerException(msg.str());
         }
@@ -70,6 +243,11 @@ namespace DeltaScript {
         parse_next_token();
     }
 
+    void Lexer::parse_next_token() {
+        if (c_token_kind != TokenKind::EOS)
+            seek(c_token_index_ + 1);
+    }
+
     void Lexer::get_next_char() {
         c_char = n_char;
 
@@ -83,40 +261,34 @@ namespace DeltaScript {
         ++c_source_position_;
     }
 
-    void Lexer::get_previous_char() {
-        n_char = c_char;
+    void Lexer::jump_to_char(size_t position) {
+        c_source_position_ = (int)position;
 
-        --c_source_position_;
+        get_next_char();
+        get_next_char();
+    }
 
-        if (c_source_position_ > 0 && (c_source_position_ - 1 < source_end_)) {
-            c_char = source_[c_source_position_ - 1];
-        }
-        else {
-            c_char = 0;
-        }
+    void Lexer::get_previous_char() {
+        jump_to_char(c_source_position_ - 3);
     }
 
-    void Lexer::parse_next_token() {
+    void Lexer::scan_next_token() {
         c_token_kind = TokenKind::EOS;
-        c_token_value = "";
-
-        while (c_char && (Util::is_white_space(c_char) || Util::is_line_terminator(c_char))) {
-            if (Util::is_line_terminator_crlf(c_char, n_char))
-                get_next_char();
+        c_token_materialized = false;
 
-            get_next_char();
-        }
+        while (true) {
+            if (c_char && (Util::is_white_space(c_char) || Util::is_line_terminator(c_char)))
+                jump_to_char(Util::skip_white_space(source_, c_source_position_ - 2, source_end_));
 
-        if (c_char == '/' && n_char == '/') {
-            process_inline_comment();
-
-            return;
-        }
-
-        if (c_char == '/' && n_char == '*') {
-            process_multiline_comment();
-
-            return;
+            if (c_char == '/' && n_char == '/') {
+                process_inline_comment();
+            }
+            else if (c_char == '/' && n_char == '*') {
+                process_multiline_comment();
+            }
+            else {
+                break;
+            }
         }
 
         c_token_start = c_source_position_ - 2;
@@ -136,65 +308,40 @@ namespace DeltaScript {
         else {
             process_punctuators();
         }
-
-        p_token_end = c_token_end;
-        // Check what is the correct c_token_end value
-        c_token_end = c_source_position_ - 1;//- 2;//- 3;//- 4;
-    }
-    
-    Lexer* Lexer::get_sub_lex(int start_position) {
-        int last_char_index = p_token_end + 1;
-
-        if (last_char_index < (int)source_end_) {
-            return new Lexer(this, start_position, last_char_index);
-        }
-        else {
-            return new Lexer(this, start_position, (int)source_end_);
-        }
     }
 
     std::string Lexer::get_sub_string(int start_position) {
-        int last_char_index = p_token_end + 1;
+        int end_position = get_previous_token_end();
 
-        if (last_char_index < source_end_) {
-            char old_char = source_[last_char_index];
-            source_[last_char_index] = 0;
+        if (end_position < start_position)
+            return "";
 
-            std::string value = &source_[start_position];
+        return std::string(&source_[start_position], end_position - start_position);
+    }
 
-            source_[last_char_index] = old_char;
+    int Lexer::get_previous_token_end() const {
+        if (c_token_index_ > 0)
+            return tokens_[c_token_index_ - 1].end;
 
-            return value;
-        }
-        else {
-            return std::string(&source_[p_token_end]);
-        }
+        return (int)source_end_;
     }
 
     void Lexer::process_inline_comment() {
-        while (c_char && c_char != '\n')
-            get_next_char();
+        jump_to_char(Util::find_line_end(source_, c_source_position_ - 2, source_end_));
 
         get_next_char();
-
-        parse_next_token();
     }
 
     void Lexer::process_multiline_comment() {
-        while (c_char && !(c_char == '*' && n_char == '/'))
-            get_next_char();
+        // The scan starts at the opening '*', so "/*/" closes itself as it always has
+        jump_to_char(Util::find_multiline_comment_end(source_, c_source_position_ - 1, source_end_));
 
         get_next_char();
         get_next_char();
-
-        parse_next_token();
     }
 
     void Lexer::process_identifier() {
-        while (Util::is_alpha(c_char) || Util::is_digit(c_char)) {
-            c_token_value += c_char;
-            get_next_char();
-        }
+        jump_to_char(Util::skip_identifier(source_, c_source_position_ - 2, source_end_));
 
         c_token_kind = TokenKind::IDENTIFIER;
 
@@ -205,164 +352,65 @@ namespace DeltaScript {
         bool is_hex = false;
 
         if (c_char == '0') {
-            c_token_value += c_char;
             get_next_char();
         }
         if (c_char == 'x') {
             is_hex = true;
-            c_token_value += c_char;
             get_next_char();
         }
 
         c_token_kind = TokenKind::INTEGER_L;
 
         while (Util::is_digit(c_char) || (is_hex && Util::is_hex(c_char))) {
-            c_token_value += c_char;
             get_next_char();
         }
 
         if (!is_hex && c_char == '.') {
             c_token_kind = TokenKind::FLOAT_L;
-            c_token_value += c_char;
             get_next_char();
 
             while (Util::is_digit(c_char)) {
-                c_token_value += c_char;
                 get_next_char();
             }
         }
 
         if (!is_hex && (c_char == 'e' || c_char == 'E')) {
             c_token_kind = TokenKind::FLOAT_L;
-            c_token_value += c_char;
             get_next_char();
 
+            if ((c_char == '+' || c_char == '-') && Util::is_digit(n_char))
+                get_next_char();
+
             while (Util::is_digit(c_char)) {
-                c_token_value += c_char;
                 get_next_char();
             }
         }
     }
 
     void Lexer::check_for_reserved_keywords() {
-        if (c_token_value == "await") {
-            c_token_kind = TokenKind::AWAIT_K;
-        }
-        else if (c_token_value == "break") {
-            c_token_kind = TokenKind::BREAK_K;
-        }
-        else if (c_token_value == "case") {
-            c_token_kind = TokenKind::CASE_K;
-        }
-        else if (c_token_value == "catch") {
-            c_token_kind = TokenKind::CATCH_K;
-        }
-        else if (c_token_value == "class") {
-            c_token_kind = TokenKind::CLASS_K;
-        }
-        else if (c_token_value == "const") {
-            c_token_kind = TokenKind::CONST_K;
-        }
-        else if (c_token_value == "continue") {
-            c_token_kind = TokenKind::CONTINUE_K;
-        }
-        else if (c_token_value == "debugger") {
-            c_token_kind = TokenKind::DEBUGGER_K;
-        }
-        else if (c_token_value == "default") {
-            c_token_kind = TokenKind::DEFAULT_K;
-        }
-        else if (c_token_value == "delete") {
-            c_token_kind = TokenKind::DELETE_K;
-        }
-        else if (c_token_value == "do") {
-            c_token_kind = TokenKind::DO_K;
-        }
-        else if (c_token_value == "else") {
-            c_token_kind = TokenKind::ELSE_K;
-        }
-        else if (c_token_value == "export") {
-            c_token_kind = TokenKind::EXPORT_K;
-        }
-        else if (c_token_value == "extends") {
-            c_token_kind = TokenKind::EXTENDS_K;
-        }
-        else if (c_token_value == "finally") {
-            c_token_kind = TokenKind::FINALLY_K;
-        }
-        else if (c_token_value == "for") {
-            c_token_kind = TokenKind::FOR_K;
-        }
-        else if (c_token_value == "function") {
-            c_token_kind = TokenKind::FUNCTION_K;
-        }
-        else if (c_token_value == "if") {
-            c_token_kind = TokenKind::IF_K;
-        }
-        else if (c_token_value == "import") {
-            c_token_kind = TokenKind::IMPORT_K;
-        }
-        else if (c_token_value == "in") {
-            c_token_kind = TokenKind::IN_K;
-        }
-        else if (c_token_value == "instanceof") {
-            c_token_kind = TokenKind::INSTANCEOF_K;
-        }
-        else if (c_token_value == "let") {
-            c_token_kind = TokenKind::LET_K;
-        }
-        else if (c_token_value == "new") {
-            c_token_kind = TokenKind::NEW_K;
-        }
-        else if (c_token_value == "return") {
-            c_token_kind = TokenKind::RETURN_K;
-        }
-        else if (c_token_value == "static") {
-            c_token_kind = TokenKind::STATIC_K;
-        }
-        else if (c_token_value == "super") {
-            c_token_kind = TokenKind::SUPER_K;
-        }
-        else if (c_token_value == "switch") {
-            c_token_kind = TokenKind::SWITCH_K;
-        }
-        else if (c_token_value == "this") {
-            c_token_kind = TokenKind::THIS_K;
-        }
-        else if (c_token_value == "throw") {
-            c_token_kind = TokenKind::THROW_K;
-        }
-        else if (c_token_value == "try") {
-            c_token_kind = TokenKind::TRY_K;
-        }
-        else if (c_token_value == "typeof") {
-            c_token_kind = TokenKind::TYPEOF_K;
-        }
-        else if (c_token_value == "undefined") {
-            c_token_kind = TokenKind::UNDEFINED_K;
-        }
-        else if (c_token_value == "var") {
-            c_token_kind = TokenKind::VAR_K;
-        }
-        else if (c_token_value == "void") {
-            c_token_kind = TokenKind::VOID_K;
-        }
-        else if (c_token_value == "while") {
-            c_token_kind = TokenKind::WHILE_K;
-        }
-        else if (c_token_value == "with") {
-            c_token_kind = TokenKind::WITH_K;
-        }
-        else if (c_token_value == "yield") {
-            c_token_kind = TokenKind::YIELD_K;
-        }
+        c_token_kind = Token::get_keyword_kind(&source_[c_token_start], c_source_position_ - 2 - c_token_start);
+    }
+
+    void Lexer::materialize_string_literal() {
+        if (c_token_materialized)
+            return;
+
+        // Copy the unescaped part of the literal seen so far, excluding the opening quote
+        c_token_value.assign(&source_[c_token_start + 1], c_source_position_ - 2 - c_token_start - 1);
+        c_token_materialized = true;
     }
 
     void Lexer::process_double_quote_string_literal() {
         get_next_char();
 
-        while (c_char && c_char != '"') {
+        while (true) {
+            skip_string_literal_run('"');
+
+            if (!c_char || c_char == '"')
+                break;
+
             if (c_char == '\\') {
+                materialize_string_literal();
                 get_next_char();
 
                 switch (c_char) {
@@ -379,9 +427,6 @@ namespace DeltaScript {
                     c_token_value += c_char;
                 }
             }
-            else {
-                c_token_value += c_char;
-            }
 
             get_next_char();
         }
@@ -394,8 +439,14 @@ namespace DeltaScript {
     void Lexer::process_single_quote_string_literal() {
         get_next_char();
 
-        while (c_char && c_char != '\'') {
+        while (true) {
+            skip_string_literal_run('\'');
+
+            if (!c_char || c_char == '\'')
+                break;
+
             if (c_char == '\\') {
+                materialize_string_literal();
                 get_next_char();
 
                 switch (c_char) {
@@ -442,14 +493,11 @@ namespace DeltaScript {
                         c_token_value += (char)strtol(buf, 0, 8);
                     }
                     else {
-                        c_token_start += c_char;
+                        c_token_value += c_char;
                     }
                 }
                 }
             }
-            else {
-                c_token_value += c_char;
-            }
 
             get_next_char();
         }
@@ -459,6 +507,23 @@ namespace DeltaScript {
         c_token_kind = TokenKind::STRING_L;
     }
 
+    void Lexer::skip_string_literal_run(char quote) {
+        size_t run_start = c_source_position_ - 2;
+
+        if (run_start >= source_end_)
+            return;
+
+        size_t run_end = Util::find_string_literal_end(source_, run_start, source_end_, quote);
+
+        if (run_end == run_start)
+            return;
+
+        if (c_token_materialized)
+            c_token_value.append(&source_[run_start], run_end - run_start);
+
+        jump_to_char(run_end);
+    }
+
     void Lexer::process_punctuators() {
         char p_char = c_char;
 
@@ -688,7 +753,7 @@ namespace DeltaScript {
         default:
             std::ostringstream msg;
             msg << "Unable to parse character '" << p_char
-                << "' at " << Token::get_position_info(source_, source_end_, c_token_start - 1)
+                << "' at " << get_position_info(c_token_start - 1)
                 << " into recognized operator sequence";
 
             throw LexerException(msg.str());
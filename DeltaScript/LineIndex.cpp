@@ -0,0 +1,69 @@
+#include <DeltaScript/DeltaScript.h>
+#include <algorithm>
+#include <sstream>
+
+namespace DeltaScript {
+    LineIndex::LineIndex(std::vector<size_t> line_starts) : line_starts_(std::move(line_starts)) {
+
+    }
+
+    LineIndex::LineIndex(const char* source, size_t source_length) {
+        line_starts_.push_back(0);
+
+        for (size_t i = 0; i < source_length; ++i) {
+            if (Util::is_line_terminator(source[i])) {
+                if ((i + 1) < source_length && Util::is_line_terminator_crlf(source[i], source[i + 1]))
+                    ++i;
+
+                line_starts_.push_back(i + 1);
+            }
+        }
+    }
+
+    size_t LineIndex::get_line_count() const {
+        return line_starts_.size();
+    }
+
+    size_t LineIndex::get_line_start(int line) const {
+        if (line < 1)
+            return 0;
+
+        if ((size_t)line > line_starts_.size())
+            return line_starts_.back();
+
+        return line_starts_[line - 1];
+    }
+
+    int LineIndex::get_line(int position) const {
+        if (position < 0)
+            position = 0;
+
+        return (int)(std::upper_bound(line_starts_.begin(), line_starts_.end(), (size_t)position) - line_starts_.begin());
+    }
+
+    void LineIndex::get_line_and_column(int position, int& line, int& column) const {
+        if (position < 0)
+            position = 0;
+
+        line = get_line(position);
+
+        // Same numbering the previous linear scan produced: the first line counts columns from 1,
+        // later lines from 0
+        if (line == 1) {
+            column = position + 1;
+        }
+        else {
+            column = position - (int)line_starts_[line - 1];
+        }
+    }
+
+    std::string LineIndex::get_position_info(int position) const {
+        int line, column;
+        get_line_and_column(position, line, column);
+
+        std::ostringstream buf;
+        buf << "(line: " << line << ", column: " << column << ")";
+
+        return buf.str();
+    }
+}  // namespace DeltaScript
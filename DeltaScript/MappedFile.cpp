@@ -0,0 +1,79 @@
+#include <DeltaScript/DeltaScript.h>
+#include <fstream>
+#include <sstream>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace DeltaScript {
+    MappedFile::MappedFile(const std::string& path) {
+        data_ = "";
+        size_ = 0;
+        mapped_ = false;
+
+#ifndef _WIN32
+        int fd = open(path.c_str(), O_RDONLY);
+
+        if (fd < 0)
+            throw DeltaScriptException("Unable to open script file '" + path + "'");
+
+        struct stat file_stat;
+
+        if (fstat(fd, &file_stat) != 0) {
+            close(fd);
+
+            throw DeltaScriptException("Unable to read script file '" + path + "'");
+        }
+
+        if (file_stat.st_size > 0) {
+            void* data = mmap(nullptr, (size_t)file_stat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+            if (data == MAP_FAILED) {
+                close(fd);
+
+                throw DeltaScriptException("Unable to map script file '" + path + "'");
+            }
+
+            // The lexer reads the source once from start to end
+            madvise(data, (size_t)file_stat.st_size, MADV_SEQUENTIAL);
+
+            data_ = (const char*)data;
+            size_ = (size_t)file_stat.st_size;
+            mapped_ = true;
+        }
+
+        close(fd);
+#else
+        std::ifstream file(path, std::ios::in | std::ios::binary);
+
+        if (!file)
+            throw DeltaScriptException("Unable to open script file '" + path + "'");
+
+        std::ostringstream contents;
+        contents << file.rdbuf();
+        buffer_ = contents.str();
+
+        data_ = buffer_.data();
+        size_ = buffer_.size();
+#endif
+    }
+
+    MappedFile::~MappedFile() {
+#ifndef _WIN32
+        if (mapped_)
+            munmap((void*)data_, size_);
+#endif
+    }
+
+    const char* MappedFile::data() const {
+        return data_;
+    }
+
+    size_t MappedFile::size() const {
+        return size_;
+    }
+}  // namespace DeltaScript
@@ -0,0 +1,603 @@
+#include <DeltaScript/DeltaScript.h>
+
+namespace DeltaScript {
+    namespace {
+        Variable* create_literal_value(const Node* node) {
+            switch (node->kind) {
+            case NodeKind::INTEGER:
+                return new Variable(node->integer);
+            case NodeKind::FLOAT:
+                return new Variable(node->number);
+            case NodeKind::STRING:
+                return new Variable(node->string, Variable::VariableFlags::STRING);
+            default:
+                return nullptr;
+            }
+        }
+    }
+
+    Node::Node(NodeKind kind, int position) : kind(kind), position(position) {
+
+    }
+
+    Parser::Parser(Lexer* lex, bool lazy_functions) : lex_(lex), lazy_functions_(lazy_functions), loop_depth_(0) {
+
+    }
+
+    std::unique_ptr<Node> Parser::parse_program() {
+        std::unique_ptr<Node> program = create_node(NodeKind::BLOCK);
+
+        while (lex_->c_token_kind != TokenKind::EOS)
+            program->children.push_back(parse_statement());
+
+        return program;
+    }
+
+    std::unique_ptr<Node> Parser::parse_statement() {
+        if (lex_->c_token_kind == TokenKind::IDENTIFIER || lex_->c_token_kind == TokenKind::INTEGER_L
+            || lex_->c_token_kind == TokenKind::FLOAT_L || lex_->c_token_kind == TokenKind::STRING_L
+            || lex_->c_token_kind == TokenKind::MINUS_P) {
+            std::unique_ptr<Node> statement = create_node(NodeKind::EXPRESSION);
+            statement->children.push_back(parse_base());
+
+            lex_->expect_and_get_next(TokenKind::SEMICOLON_P);
+
+            return statement;
+        }
+        else if (lex_->c_token_kind == TokenKind::LBRACE_P) {
+            return parse_block();
+        }
+        else if (lex_->c_token_kind == TokenKind::SEMICOLON_P) {
+            std::unique_ptr<Node> statement = create_node(NodeKind::EMPTY);
+            lex_->parse_next_token();
+
+            return statement;
+        }
+        else if (lex_->c_token_kind == TokenKind::VAR_K) {
+            std::unique_ptr<Node> statement = create_node(NodeKind::VAR);
+            lex_->parse_next_token();
+
+            while (lex_->c_token_kind != TokenKind::SEMICOLON_P) {
+                std::unique_ptr<Node> declaration = create_node(NodeKind::DECLARATION);
+
+                declaration->atoms.push_back(&lex_->get_token_atom());
+                lex_->expect_and_get_next(TokenKind::IDENTIFIER);
+
+                while (lex_->c_token_kind == TokenKind::PERIOD_P) {
+                    lex_->parse_next_token();
+
+                    declaration->atoms.push_back(&lex_->get_token_atom());
+                    lex_->expect_and_get_next(TokenKind::IDENTIFIER);
+                }
+
+                if (lex_->c_token_kind == TokenKind::ASSIGN_P) {
+                    lex_->parse_next_token();
+
+                    declaration->children.push_back(parse_base());
+                }
+
+                statement->children.push_back(std::move(declaration));
+
+                if (lex_->c_token_kind != TokenKind::SEMICOLON_P)
+                    lex_->expect_and_get_next(TokenKind::COMMA_P);
+            }
+
+            lex_->expect_and_get_next(TokenKind::SEMICOLON_P);
+
+            return statement;
+        }
+        else if (lex_->c_token_kind == TokenKind::IF_K) {
+            std::unique_ptr<Node> statement = create_node(NodeKind::IF);
+            lex_->parse_next_token();
+
+            lex_->expect_and_get_next(TokenKind::LPAREN_P);
+            statement->children.push_back(parse_base());
+            lex_->expect_and_get_next(TokenKind::RPAREN_P);
+
+            statement->children.push_back(parse_conditional_statement(statement->children[0].get(), true));
+
+            if (lex_->c_token_kind == TokenKind::ELSE_K) {
+                lex_->parse_next_token();
+
+                statement->children.push_back(parse_conditional_statement(statement->children[0].get(), false));
+            }
+
+            return statement;
+        }
+        else if (lex_->c_token_kind == TokenKind::WHILE_K) {
+            std::unique_ptr<Node> statement = create_node(NodeKind::WHILE);
+            lex_->parse_next_token();
+
+            lex_->expect_and_get_next(TokenKind::LPAREN_P);
+            statement->children.push_back(parse_base());
+            lex_->expect_and_get_next(TokenKind::RPAREN_P);
+
+            ++loop_depth_;
+            statement->children.push_back(parse_conditional_statement(statement->children[0].get(), true));
+            --loop_depth_;
+
+            return statement;
+        }
+        else if (lex_->c_token_kind == TokenKind::FOR_K) {
+            std::unique_ptr<Node> statement = create_node(NodeKind::FOR);
+            lex_->parse_next_token();
+            lex_->expect_and_get_next(TokenKind::LPAREN_P);
+
+            statement->children.push_back(parse_statement());
+            statement->children.push_back(parse_base());
+            lex_->expect_and_get_next(TokenKind::SEMICOLON_P);
+
+            statement->children.push_back(parse_base());
+            lex_->expect_and_get_next(TokenKind::RPAREN_P);
+
+            ++loop_depth_;
+            statement->children.push_back(parse_statement());
+            --loop_depth_;
+
+            return statement;
+        }
+        else if (lex_->c_token_kind == TokenKind::BREAK_K || lex_->c_token_kind == TokenKind::CONTINUE_K) {
+            std::unique_ptr<Node> statement = create_node(lex_->c_token_kind == TokenKind::BREAK_K ? NodeKind::BREAK : NodeKind::CONTINUE);
+
+            if (loop_depth_ == 0)
+                throw DeltaScriptException("Unexpected " + Token::get_token_kind_as_string(lex_->c_token_kind)
+                    + " outside of a loop at " + lex_->get_position_info(lex_->c_token_start));
+
+            lex_->parse_next_token();
+            lex_->expect_and_get_next(TokenKind::SEMICOLON_P);
+
+            return statement;
+        }
+        else if (lex_->c_token_kind == TokenKind::RETURN_K) {
+            std::unique_ptr<Node> statement = create_node(NodeKind::RETURN);
+            lex_->parse_next_token();
+
+            if (lex_->c_token_kind != TokenKind::SEMICOLON_P)
+                statement->children.push_back(parse_base());
+
+            lex_->expect_and_get_next(TokenKind::SEMICOLON_P);
+
+            return statement;
+        }
+        else if (lex_->c_token_kind == TokenKind::FUNCTION_K) {
+            std::unique_ptr<Node> statement = parse_function_definition();
+
+            if (!statement->atom)
+                throw DeltaScriptException("Functions defined at statement-level are meant to have a name");
+
+            statement->kind = NodeKind::FUNCTION_DECLARATION;
+
+            return statement;
+        }
+        else if (lex_->c_token_kind == TokenKind::EOS) {
+            return create_node(NodeKind::EMPTY);
+        }
+        else { // TODO: Other reserved words
+            lex_->expect_and_get_next(TokenKind::EOS);
+
+            return nullptr;
+        }
+    }
+
+    std::unique_ptr<Node> Parser::parse_block() {
+        std::unique_ptr<Node> block = create_node(NodeKind::BLOCK);
+        lex_->expect_and_get_next(TokenKind::LBRACE_P);
+
+        while (lex_->c_token_kind != TokenKind::EOS && lex_->c_token_kind != TokenKind::RBRACE_P)
+            block->children.push_back(parse_statement());
+
+        lex_->expect_and_get_next(TokenKind::RBRACE_P);
+
+        return block;
+    }
+
+    std::unique_ptr<Node> Parser::parse_function_definition() {
+        std::unique_ptr<Node> function = create_node(NodeKind::FUNCTION);
+        lex_->expect_and_get_next(TokenKind::FUNCTION_K);
+
+        if (lex_->c_token_kind == TokenKind::IDENTIFIER) {
+            function->atom = &lex_->get_token_atom();
+            lex_->parse_next_token();
+        }
+
+        function->atoms = parse_function_arguments();
+
+        int function_begin = lex_->c_token_start;
+
+        if (lazy_functions_ && lex_->c_token_kind == TokenKind::LBRACE_P) {
+            int body_end = lex_->get_matching_token(lex_->get_token_index());
+
+            if (body_end >= 0) {
+                lex_->seek(body_end);
+                lex_->parse_next_token();
+
+                function->integer = function_begin;
+                function->end_position = lex_->get_previous_token_end();
+
+                return function;
+            }
+        }
+
+        // Loops around the definition do not reach into the body
+        int outer_loop_depth = loop_depth_;
+        loop_depth_ = 0;
+
+        function->children.push_back(parse_block());
+        loop_depth_ = outer_loop_depth;
+        function->string = lex_->get_sub_string(function_begin);
+
+        return function;
+    }
+
+    std::vector<const Atom*> Parser::parse_function_arguments() {
+        std::vector<const Atom*> arguments;
+        lex_->expect_and_get_next(TokenKind::LPAREN_P);
+
+        while (lex_->c_token_kind != TokenKind::RPAREN_P) {
+            arguments.push_back(&lex_->get_token_atom());
+
+            lex_->expect_and_get_next(TokenKind::IDENTIFIER);
+
+            if (lex_->c_token_kind != TokenKind::RPAREN_P)
+                lex_->expect_and_get_next(TokenKind::COMMA_P);
+        }
+
+        lex_->expect_and_get_next(TokenKind::RPAREN_P);
+
+        return arguments;
+    }
+
+    std::unique_ptr<Node> Parser::parse_function_call(std::unique_ptr<Node> function) {
+        std::unique_ptr<Node> call = create_node(NodeKind::CALL);
+        call->children.push_back(std::move(function));
+
+        lex_->expect_and_get_next(TokenKind::LPAREN_P);
+
+        while (lex_->c_token_kind != TokenKind::RPAREN_P) {
+            call->children.push_back(parse_base());
+
+            if (lex_->c_token_kind != TokenKind::RPAREN_P)
+                lex_->expect_and_get_next(TokenKind::COMMA_P);
+        }
+
+        lex_->expect_and_get_next(TokenKind::RPAREN_P);
+
+        return call;
+    }
+
+    std::unique_ptr<Node> Parser::parse_factor() {
+        if (lex_->c_token_kind == TokenKind::LPAREN_P) {
+            lex_->parse_next_token();
+
+            std::unique_ptr<Node> a = parse_base();
+            lex_->expect_and_get_next(TokenKind::RPAREN_P);
+
+            return a;
+        }
+        else if (lex_->c_token_kind == TokenKind::TRUE_L || lex_->c_token_kind == TokenKind::FALSE_L) {
+            std::unique_ptr<Node> a = create_node(NodeKind::INTEGER);
+            a->integer = lex_->c_token_kind == TokenKind::TRUE_L ? 1 : 0;
+            lex_->parse_next_token();
+
+            return a;
+        }
+        else if (lex_->c_token_kind == TokenKind::NULL_L) {
+            std::unique_ptr<Node> a = create_node(NodeKind::NULL_);
+            lex_->parse_next_token();
+
+            return a;
+        }
+        else if (lex_->c_token_kind == TokenKind::UNDEFINED_K) {
+            std::unique_ptr<Node> a = create_node(NodeKind::UNDEFINED);
+            lex_->parse_next_token();
+
+            return a;
+        }
+        else if (lex_->c_token_kind == TokenKind::IDENTIFIER) {
+            std::unique_ptr<Node> a = create_node(NodeKind::IDENTIFIER);
+            a->atom = &lex_->get_token_atom();
+
+            // TODO: Handle reserved keywords somehow
+            lex_->expect_and_get_next(TokenKind::IDENTIFIER);
+
+            while (lex_->c_token_kind == TokenKind::LPAREN_P || lex_->c_token_kind == TokenKind::PERIOD_P || lex_->c_token_kind == TokenKind::LBRACK_P) {
+                if (lex_->c_token_kind == TokenKind::LPAREN_P) {
+                    a = parse_function_call(std::move(a));
+                }
+                else if (lex_->c_token_kind == TokenKind::PERIOD_P) {
+                    lex_->parse_next_token();
+
+                    std::unique_ptr<Node> property = create_node(NodeKind::PROPERTY);
+                    property->atom = &lex_->get_token_atom();
+                    property->children.push_back(std::move(a));
+                    a = std::move(property);
+
+                    lex_->expect_and_get_next(TokenKind::IDENTIFIER);
+                }
+                else if (lex_->c_token_kind == TokenKind::LBRACK_P) {
+                    lex_->parse_next_token();
+
+                    std::unique_ptr<Node> index = create_node(NodeKind::INDEX);
+                    index->children.push_back(std::move(a));
+                    index->children.push_back(parse_base());
+                    a = std::move(index);
+
+                    lex_->expect_and_get_next(TokenKind::RBRACK_P);
+                }
+            }
+
+            return a;
+        }
+        else if (lex_->c_token_kind == TokenKind::INTEGER_L) {
+            std::unique_ptr<Node> a = create_node(NodeKind::INTEGER);
+            a->integer = lex_->get_token_integer();
+            lex_->parse_next_token();
+
+            return a;
+        }
+        else if (lex_->c_token_kind == TokenKind::FLOAT_L) {
+            std::unique_ptr<Node> a = create_node(NodeKind::FLOAT);
+            a->number = lex_->get_token_float();
+            lex_->parse_next_token();
+
+            return a;
+        }
+        else if (lex_->c_token_kind == TokenKind::STRING_L) {
+            std::unique_ptr<Node> a = create_node(NodeKind::STRING);
+            a->string = lex_->get_token_value();
+            lex_->parse_next_token();
+
+            return a;
+        }
+        else if (lex_->c_token_kind == TokenKind::LBRACE_P) {
+            // TODO: Create object
+            return create_node(NodeKind::UNDEFINED);
+        }
+        else if (lex_->c_token_kind == TokenKind::LBRACK_P) {
+            // TODO: Create array
+            return create_node(NodeKind::UNDEFINED);
+        }
+        else if (lex_->c_token_kind == TokenKind::FUNCTION_K) {
+            std::unique_ptr<Node> function = parse_function_definition();
+
+            if (function->atom)
+                throw DeltaScriptException("Functions not defined at statement-level are not meant to have a name");
+
+            return function;
+        }
+        else if (lex_->c_token_kind == TokenKind::EOS) {
+            throw LexerException("Unexpected " + Token::get_token_kind_as_string(TokenKind::EOS)
+                + " at " + lex_->get_position_info(lex_->c_token_start));
+        }
+
+        lex_->expect_and_get_next(TokenKind::EOS);
+        return nullptr;
+    }
+
+    std::unique_ptr<Node> Parser::parse_unary() {
+        if (lex_->c_token_kind == TokenKind::NOT_P) {
+            std::unique_ptr<Node> a = create_node(NodeKind::NOT);
+            lex_->parse_next_token();
+
+            a->children.push_back(parse_factor());
+
+            return fold_constant(std::move(a));
+        }
+
+        return parse_factor();
+    }
+
+    std::unique_ptr<Node> Parser::parse_term() {
+        std::unique_ptr<Node> a = parse_unary();
+
+        while (lex_->c_token_kind == TokenKind::MUL_P || lex_->c_token_kind == TokenKind::DIV_P
+            || lex_->c_token_kind == TokenKind::MOD_P) {
+            TokenKind operation = lex_->c_token_kind;
+            lex_->parse_next_token();
+
+            a = create_node(NodeKind::BINARY, operation, std::move(a), parse_unary());
+        }
+
+        return a;
+    }
+
+    std::unique_ptr<Node> Parser::parse_expression() {
+        bool negate = false;
+
+        if (lex_->c_token_kind == TokenKind::MINUS_P) {
+            lex_->parse_next_token();
+            negate = true;
+        }
+
+        std::unique_ptr<Node> a = parse_term();
+
+        if (negate)
+            a = create_node(NodeKind::NEGATE, TokenKind::MINUS_P, std::move(a));
+
+        while (lex_->c_token_kind == TokenKind::PLUS_P || lex_->c_token_kind == TokenKind::MINUS_P
+            || lex_->c_token_kind == TokenKind::INCR_P || lex_->c_token_kind == TokenKind::DECR_P) {
+            TokenKind operation = lex_->c_token_kind;
+            lex_->parse_next_token();
+
+            if (operation == TokenKind::INCR_P || operation == TokenKind::DECR_P) {
+                a = create_node(NodeKind::POSTFIX, operation, std::move(a));
+            }
+            else {
+                a = create_node(NodeKind::BINARY, operation, std::move(a), parse_term());
+            }
+        }
+
+        return a;
+    }
+
+    std::unique_ptr<Node> Parser::parse_shift() {
+        std::unique_ptr<Node> a = parse_expression();
+
+        if (lex_->c_token_kind == TokenKind::SHFT_L_P || lex_->c_token_kind == TokenKind::SHFT_R_P
+            || lex_->c_token_kind == TokenKind::SHFT_RR_P) {
+            TokenKind operation = lex_->c_token_kind;
+            lex_->parse_next_token();
+
+            a = create_node(NodeKind::SHIFT, operation, std::move(a), parse_base());
+        }
+
+        return a;
+    }
+
+    std::unique_ptr<Node> Parser::parse_condition() {
+        std::unique_ptr<Node> a = parse_shift();
+
+        while (lex_->c_token_kind == TokenKind::EQUAL_P || lex_->c_token_kind == TokenKind::NEQUAL_P
+            || lex_->c_token_kind == TokenKind::STRICT_EQUAL_P || lex_->c_token_kind == TokenKind::STRICT_NEQUAL_P
+            || lex_->c_token_kind == TokenKind::LTE_P || lex_->c_token_kind == TokenKind::GTE_P
+            || lex_->c_token_kind == TokenKind::LT_P || lex_->c_token_kind == TokenKind::GT_P) {
+            TokenKind operation = lex_->c_token_kind;
+            lex_->parse_next_token();
+
+            a = create_node(NodeKind::BINARY, operation, std::move(a), parse_shift());
+        }
+
+        return a;
+    }
+
+    std::unique_ptr<Node> Parser::parse_logic() {
+        std::unique_ptr<Node> a = parse_condition();
+
+        while (lex_->c_token_kind == TokenKind::BIT_AND_P || lex_->c_token_kind == TokenKind::BIT_OR_P
+            || lex_->c_token_kind == TokenKind::AND_P || lex_->c_token_kind == TokenKind::OR_P) {
+            TokenKind operation = lex_->c_token_kind;
+            lex_->parse_next_token();
+
+            a = create_node(NodeKind::LOGIC, operation, std::move(a), parse_condition());
+        }
+
+        return a;
+    }
+
+    std::unique_ptr<Node> Parser::parse_ternary() {
+        std::unique_ptr<Node> a = parse_logic();
+
+        if (lex_->c_token_kind == TokenKind::CONDITIONAL_P) {
+            lex_->parse_next_token();
+
+            std::unique_ptr<Node> ternary = create_node(NodeKind::TERNARY);
+            ternary->children.push_back(std::move(a));
+            ternary->children.push_back(parse_base());
+
+            lex_->expect_and_get_next(TokenKind::COLON_P);
+            ternary->children.push_back(parse_base());
+
+            a = std::move(ternary);
+        }
+
+        return a;
+    }
+
+    std::unique_ptr<Node> Parser::parse_base() {
+        std::unique_ptr<Node> a = parse_ternary();
+
+        if (lex_->c_token_kind == TokenKind::ASSIGN_P || lex_->c_token_kind == TokenKind::PLUS_EQ_P
+            || lex_->c_token_kind == TokenKind::MINUS_EQ_P) {
+            TokenKind operation = lex_->c_token_kind;
+            lex_->parse_next_token();
+
+            a = create_node(NodeKind::ASSIGN, operation, std::move(a), parse_base());
+        }
+
+        return a;
+    }
+
+    std::unique_ptr<Node> Parser::create_node(NodeKind kind) {
+        return std::unique_ptr<Node>(new Node(kind, lex_->c_token_start));
+    }
+
+    std::unique_ptr<Node> Parser::create_node(NodeKind kind, TokenKind operation, std::unique_ptr<Node> first, std::unique_ptr<Node> second) {
+        std::unique_ptr<Node> node(new Node(kind, first->position));
+        node->operation = operation;
+        node->children.push_back(std::move(first));
+
+        if (second)
+            node->children.push_back(std::move(second));
+
+        return fold_constant(std::move(node));
+    }
+
+    std::unique_ptr<Node> Parser::parse_conditional_statement(const Node* condition, bool run_if) {
+        std::unique_ptr<Variable> value(create_literal_value(condition));
+
+        if (value && value->get_bool() != run_if && lex_->c_token_kind == TokenKind::LBRACE_P) {
+            int block_end = lex_->get_matching_token(lex_->get_token_index());
+
+            if (block_end >= 0) {
+                std::unique_ptr<Node> skipped = create_node(NodeKind::EMPTY);
+
+                lex_->seek(block_end);
+                lex_->parse_next_token();
+
+                return skipped;
+            }
+        }
+
+        return parse_statement();
+    }
+
+    std::unique_ptr<Node> Parser::fold_constant(std::unique_ptr<Node> node) {
+        if (node->kind != NodeKind::BINARY && node->kind != NodeKind::NEGATE && node->kind != NodeKind::NOT)
+            return node;
+
+        std::unique_ptr<Variable> first(create_literal_value(node->children[0].get()));
+        std::unique_ptr<Variable> second;
+
+        if (!first)
+            return node;
+
+        if (node->kind == NodeKind::BINARY) {
+            second.reset(create_literal_value(node->children[1].get()));
+
+            if (!second)
+                return node;
+
+            // Integer division by zero is left to fail at run time
+            if ((node->operation == TokenKind::DIV_P || node->operation == TokenKind::MOD_P)
+                && second->is_numeric() && second->get_double() == 0)
+                return node;
+        }
+
+        std::unique_ptr<Variable> result;
+
+        try {
+            Variable zero(0);
+
+            if (node->kind == NodeKind::BINARY)
+                result.reset(first->execute_math_operation(second.get(), node->operation));
+            else if (node->kind == NodeKind::NEGATE)
+                result.reset(zero.execute_math_operation(first.get(), TokenKind::MINUS_P));
+            else
+                result.reset(first->execute_math_operation(&zero, TokenKind::EQUAL_P));
+        }
+        catch (const DeltaScriptException&) {
+            // Operations that fail keep failing when the script runs
+            return node;
+        }
+
+        std::unique_ptr<Node> folded;
+
+        if (result->is_int()) {
+            folded.reset(new Node(NodeKind::INTEGER, node->position));
+            folded->integer = result->get_int();
+        }
+        else if (result->is_double()) {
+            folded.reset(new Node(NodeKind::FLOAT, node->position));
+            folded->number = result->get_double();
+        }
+        else if (result->is_string()) {
+            folded.reset(new Node(NodeKind::STRING, node->position));
+            folded->string = result->get_string();
+        }
+        else {
+            return node;
+        }
+
+        return folded;
+    }
+}  // namespace DeltaScript
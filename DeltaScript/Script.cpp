@@ -0,0 +1,20 @@
+#include <DeltaScript/DeltaScript.h>
+
+namespace DeltaScript {
+    Script::Script(std::shared_ptr<const Source> source, std::shared_ptr<const Chunk> program)
+        : source_(std::move(source)), program_(std::move(program)) {
+
+    }
+
+    void Script::run(Context& context) const {
+        context.execute(*this);
+    }
+
+    const std::shared_ptr<const Source>& Script::get_source() const {
+        return source_;
+    }
+
+    const std::shared_ptr<const Chunk>& Script::get_program() const {
+        return program_;
+    }
+}  // namespace DeltaScript
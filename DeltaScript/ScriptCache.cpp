@@ -0,0 +1,584 @@
+#include <DeltaScript/DeltaScript.h>
+#include <cstdio>
+#include <cstring>
+#include <chrono>
+#include <fstream>
+#include <thread>
+
+#ifndef DELTASCRIPT_VERSION
+#define DELTASCRIPT_VERSION "unknown"
+#endif
+
+namespace DeltaScript {
+    namespace {
+        const char cache_magic[8] = { 'D', 'S', 'C', 'A', 'C', 'H', 'E', 0 };
+        // Bump whenever the layout below or the meaning of the bytecode changes
+        const uint32_t cache_format_version = 2;
+        const uint32_t cache_byte_order = 0x01020304;
+
+        enum class ConstantKind : uint8_t {
+            INTEGER,
+            FLOAT,
+            STRING,
+        };
+
+        // Fixed size start of every cache file, followed by payload_size bytes of payload:
+        //
+        //   atoms:     count, then per atom its length and name
+        //   lines:     count, then the offset at which each line of the source starts
+        //   chunks:    count, then per chunk, the program first:
+        //              code, atoms (atom ids), constants (kind and value), functions (chunk
+        //              indices), name (atom id or -1), parameters (atom ids), source (empty for
+        //              lazy bodies), whether the body is compiled on the first call and the body
+        //              range
+        //
+        // Counts and lengths are uint32_t, offsets and sizes uint64_t, all in host byte order.
+        // The stack size of each chunk is not stored, verify_code computes it from the code.
+        struct CacheHeader {
+            char magic[8];
+            uint32_t format_version;
+            uint32_t byte_order;
+            uint32_t opcode_count;
+            uint32_t reserved;
+            char engine_version[32];
+            uint64_t source_hash;
+            uint64_t source_size;
+            uint64_t payload_size;
+            uint64_t payload_checksum;
+        };
+
+        void fill_header(CacheHeader& header, const Source& source) {
+            memset(&header, 0, sizeof(header));
+            memcpy(header.magic, cache_magic, sizeof(cache_magic));
+            header.format_version = cache_format_version;
+            header.byte_order = cache_byte_order;
+            header.opcode_count = (uint32_t)OpCode::END + 1;
+            strncpy(header.engine_version, DELTASCRIPT_VERSION, sizeof(header.engine_version) - 1);
+            header.source_hash = Util::hash_bytes(source.data(), source.size());
+            header.source_size = source.size();
+        }
+
+        class CacheWriter {
+        public:
+            std::string buffer;
+
+            template <typename T>
+            void write(T value) {
+                buffer.append((const char*)&value, sizeof(value));
+            }
+
+            void write_string(const std::string& value) {
+                write((uint32_t)value.size());
+                buffer.append(value);
+            }
+        };
+
+        // Bounds-checked reads from the mapped payload
+        class CacheReader {
+        private:
+            const char* data_;
+            size_t size_;
+            size_t position_;
+
+        public:
+            CacheReader(const char* data, size_t size) : data_(data), size_(size), position_(0) {
+
+            }
+
+            template <typename T>
+            T read() {
+                T value;
+                memcpy(&value, read_bytes(sizeof(value)), sizeof(value));
+
+                return value;
+            }
+
+            const char* read_bytes(size_t length) {
+                if (length > size_ - position_)
+                    throw DeltaScriptException("Script cache entry is truncated");
+
+                const char* bytes = data_ + position_;
+                position_ += length;
+
+                return bytes;
+            }
+
+            std::string read_string() {
+                uint32_t length = read<uint32_t>();
+
+                return std::string(read_bytes(length), length);
+            }
+
+            // Reads a count of items that take at least item_size bytes each
+            uint32_t read_count(size_t item_size) {
+                uint32_t count = read<uint32_t>();
+
+                if (item_size && count > (size_ - position_) / item_size)
+                    throw DeltaScriptException("Script cache entry is truncated");
+
+                return count;
+            }
+
+            bool at_end() const {
+                return position_ == size_;
+            }
+        };
+
+        DeltaScriptException corrupted() {
+            return DeltaScriptException("Script cache entry is corrupted");
+        }
+
+        // Checks the code of a loaded chunk as the VM would run it: every operand has to index
+        // what it names, jumps have to land in the code, no path may run past the end or pop
+        // more than it pushed, and paths that meet have to agree on the stack depth. Returns
+        // the deepest the operand stack gets, which is what the frame is sized for.
+        size_t verify_code(const Chunk& chunk, size_t function_count) {
+            const std::vector<unsigned int>& code = chunk.code;
+            const size_t unvisited = (size_t)-1;
+            std::vector<size_t> depths(code.size(), unvisited);
+            std::vector<size_t> pending;
+            size_t max_depth = 0;
+
+            auto reach = [&](size_t target, size_t depth) {
+                if (target >= code.size())
+                    throw corrupted();
+
+                if (depths[target] == unvisited) {
+                    depths[target] = depth;
+                    pending.push_back(target);
+                }
+                else if (depths[target] != depth) {
+                    throw corrupted();
+                }
+            };
+
+            reach(0, 0);
+
+            while (!pending.empty()) {
+                size_t ip = pending.back();
+                pending.pop_back();
+
+                OpCode op = (OpCode)(code[ip] & 0xFF);
+                unsigned int operand = code[ip] >> 8;
+                size_t pops = 0;
+                size_t pushes = 0;
+                bool jumps = false;
+                bool falls_through = true;
+
+                switch (op) {
+                case OpCode::PUSH_UNDEFINED:
+                case OpCode::PUSH_NULL:
+                    pushes = 1;
+                    break;
+                case OpCode::PUSH_CONSTANT:
+                    if (operand >= chunk.constants.size())
+                        throw corrupted();
+
+                    pushes = 1;
+                    break;
+                case OpCode::PUSH_FUNCTION:
+                    if (operand >= function_count)
+                        throw corrupted();
+
+                    pushes = 1;
+                    break;
+                case OpCode::LOAD:
+                case OpCode::DECLARE:
+                    if (operand >= chunk.atoms.size())
+                        throw corrupted();
+
+                    pushes = 1;
+                    break;
+                case OpCode::GET_PROPERTY:
+                case OpCode::DECLARE_PROPERTY:
+                    if (operand >= chunk.atoms.size())
+                        throw corrupted();
+
+                    pops = pushes = 1;
+                    break;
+                case OpCode::NOT:
+                case OpCode::NEGATE:
+                case OpCode::POSTFIX:
+                case OpCode::PREPARE_ASSIGN:
+                    pops = pushes = 1;
+                    break;
+                case OpCode::GET_INDEX:
+                case OpCode::BINARY:
+                case OpCode::SHIFT:
+                case OpCode::BOOLEAN:
+                case OpCode::ASSIGN:
+                case OpCode::INITIALIZE:
+                    pops = 2;
+                    pushes = 1;
+                    break;
+                case OpCode::POP:
+                    pops = 1;
+                    break;
+                case OpCode::CALL:
+                    pops = (size_t)operand + 1;
+                    pushes = 1;
+                    break;
+                case OpCode::JUMP:
+                    jumps = true;
+                    falls_through = false;
+                    break;
+                case OpCode::JUMP_IF_FALSE:
+                    pops = 1;
+                    jumps = true;
+                    break;
+                case OpCode::JUMP_IF_FALSE_KEEP:
+                case OpCode::JUMP_IF_TRUE_KEEP:
+                    pops = pushes = 1;
+                    jumps = true;
+                    break;
+                case OpCode::RETURN:
+                    pops = operand ? 1 : 0;
+                    falls_through = false;
+                    break;
+                case OpCode::END:
+                    falls_through = false;
+                    break;
+                default:
+                    throw corrupted();
+                }
+
+                if (depths[ip] < pops)
+                    throw corrupted();
+
+                size_t depth = depths[ip] - pops + pushes;
+
+                if (depth > max_depth)
+                    max_depth = depth;
+
+                if (jumps)
+                    reach(operand, depth);
+
+                if (falls_through)
+                    reach(ip + 1, depth);
+            }
+
+            return max_depth;
+        }
+
+        void collect_chunks(const Chunk* chunk, std::vector<const Chunk*>& chunks) {
+            chunks.push_back(chunk);
+
+            for (auto& function : chunk->functions)
+                collect_chunks(function.get(), chunks);
+        }
+    }
+
+    ScriptCache::ScriptCache(const std::string& directory) : directory_(directory) {
+        if (!directory_.empty() && directory_.back() != '/' && directory_.back() != '\\')
+            directory_ += '/';
+    }
+
+    Script ScriptCache::get(const Context& context, std::shared_ptr<const Source> source) const {
+        std::string path = directory_ + get_entry_name(*source);
+        std::unique_ptr<Script> cached = read(path, source);
+
+        if (cached)
+            return *cached;
+
+        Script script = context.compile(source);
+
+        // Another process may be writing the same entry, each one writes a file of its own and
+        // moves it into place
+        std::string temporary_path = path + "." + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id()))
+            + "." + std::to_string(std::chrono::steady_clock::now().time_since_epoch().count());
+
+        try {
+            write(script, temporary_path);
+
+            if (std::rename(temporary_path.c_str(), path.c_str()) != 0) {
+                std::remove(path.c_str());
+                std::rename(temporary_path.c_str(), path.c_str());
+            }
+        }
+        catch (const DeltaScriptException&) {
+            // The cache only saves time, the script runs without it
+        }
+
+        std::remove(temporary_path.c_str());
+
+        return script;
+    }
+
+    Script ScriptCache::get_file(const Context& context, const std::string& path) const {
+        return get(context, Source::from_file(path));
+    }
+
+    std::string ScriptCache::get_entry_name(const Source& source) {
+        char hash[17];
+        snprintf(hash, sizeof(hash), "%016llx", (unsigned long long)Util::hash_bytes(source.data(), source.size()));
+
+        return std::string(hash) + "-" + DELTASCRIPT_VERSION + ".dsc";
+    }
+
+    void ScriptCache::write(const Script& script, const std::string& path) {
+        const Source& source = *script.get_source();
+        const Chunk* program = script.get_program().get();
+
+        std::vector<const Chunk*> chunks;
+        collect_chunks(program, chunks);
+
+        std::unordered_map<const Chunk*, uint32_t> chunk_indices;
+        std::unordered_map<const Atom*, uint32_t> atom_ids;
+        std::vector<const Atom*> atoms;
+
+        auto get_atom_id = [&](const Atom* atom) {
+            auto it = atom_ids.find(atom);
+
+            if (it != atom_ids.end())
+                return it->second;
+
+            atoms.push_back(atom);
+
+            return atom_ids[atom] = (uint32_t)atoms.size() - 1;
+        };
+
+        for (size_t i = 0; i < chunks.size(); ++i) {
+            chunk_indices[chunks[i]] = (uint32_t)i;
+
+            for (const Atom* atom : chunks[i]->atoms)
+                get_atom_id(atom);
+
+            for (const Atom* atom : chunks[i]->parameters)
+                get_atom_id(atom);
+
+            if (chunks[i]->name)
+                get_atom_id(chunks[i]->name);
+        }
+
+        CacheWriter chunk_data;
+        chunk_data.write((uint32_t)chunks.size());
+
+        for (const Chunk* chunk : chunks) {
+            chunk_data.write((uint32_t)chunk->code.size());
+            chunk_data.buffer.append((const char*)chunk->code.data(), chunk->code.size() * sizeof(unsigned int));
+
+            chunk_data.write((uint32_t)chunk->atoms.size());
+            for (const Atom* atom : chunk->atoms)
+                chunk_data.write(atom_ids[atom]);
+
+            chunk_data.write((uint32_t)chunk->constants.size());
+            for (VariableReference* constant : chunk->constants) {
+                const Variable* value = constant->var;
+
+                if (value->is_int()) {
+                    chunk_data.write(ConstantKind::INTEGER);
+                    chunk_data.write((int64_t)value->int_data_);
+                }
+                else if (value->is_double()) {
+                    chunk_data.write(ConstantKind::FLOAT);
+                    chunk_data.write(value->double_data_);
+                }
+                else {
+                    chunk_data.write(ConstantKind::STRING);
+                    chunk_data.write_string(value->str_data_);
+                }
+            }
+
+            chunk_data.write((uint32_t)chunk->functions.size());
+            for (auto& function : chunk->functions)
+                chunk_data.write(chunk_indices[function.get()]);
+
+            chunk_data.write(chunk->name ? (int32_t)atom_ids[chunk->name] : (int32_t)-1);
+
+            chunk_data.write((uint32_t)chunk->parameters.size());
+            for (const Atom* atom : chunk->parameters)
+                chunk_data.write(atom_ids[atom]);
+
+            chunk_data.write_string(chunk->source);
+
+            chunk_data.write((uint8_t)(chunk->lazy_source ? 1 : 0));
+            chunk_data.write((uint64_t)chunk->lazy_begin);
+            chunk_data.write((uint64_t)chunk->lazy_end);
+        }
+
+        CacheWriter payload;
+        payload.write((uint32_t)atoms.size());
+        for (const Atom* atom : atoms)
+            payload.write_string(atom->name);
+
+        const LineIndex& line_index = source.get_line_index();
+        payload.write((uint32_t)line_index.get_line_count());
+        for (size_t line = 1; line <= line_index.get_line_count(); ++line)
+            payload.write((uint64_t)line_index.get_line_start((int)line));
+
+        payload.buffer += chunk_data.buffer;
+
+        CacheHeader header;
+        fill_header(header, source);
+        header.payload_size = payload.buffer.size();
+        header.payload_checksum = Util::hash_bytes(payload.buffer.data(), payload.buffer.size());
+
+        std::ofstream file(path, std::ios::out | std::ios::binary | std::ios::trunc);
+        file.write((const char*)&header, sizeof(header));
+        file.write(payload.buffer.data(), payload.buffer.size());
+        file.close();
+
+        if (!file)
+            throw DeltaScriptException("Unable to write script cache entry '" + path + "'");
+    }
+
+    std::unique_ptr<Script> ScriptCache::read(const std::string& path, std::shared_ptr<const Source> source) {
+        std::unique_ptr<MappedFile> file;
+
+        try {
+            file.reset(new MappedFile(path));
+        }
+        catch (const DeltaScriptException&) {
+            return nullptr;
+        }
+
+        CacheHeader expected;
+        fill_header(expected, *source);
+
+        CacheHeader header;
+
+        if (file->size() < sizeof(header))
+            return nullptr;
+
+        memcpy(&header, file->data(), sizeof(header));
+
+        if (memcmp(header.magic, expected.magic, sizeof(header.magic)) != 0
+            || header.format_version != expected.format_version
+            || header.byte_order != expected.byte_order
+            || header.opcode_count != expected.opcode_count
+            || memcmp(header.engine_version, expected.engine_version, sizeof(header.engine_version)) != 0
+            || header.source_hash != expected.source_hash
+            || header.source_size != expected.source_size
+            || header.payload_size != file->size() - sizeof(header))
+            return nullptr;
+
+        const char* payload = file->data() + sizeof(header);
+
+        if (Util::hash_bytes(payload, (size_t)header.payload_size) != header.payload_checksum)
+            return nullptr;
+
+        try {
+            CacheReader reader(payload, (size_t)header.payload_size);
+            std::shared_ptr<AtomTable> atom_table = std::make_shared<AtomTable>();
+            std::vector<const Atom*> atoms(reader.read_count(sizeof(uint32_t)));
+
+            for (size_t i = 0; i < atoms.size(); ++i)
+                atoms[i] = &atom_table->get(atom_table->intern(reader.read_string()));
+
+            auto read_atom = [&]() {
+                uint32_t id = reader.read<uint32_t>();
+
+                if (id >= atoms.size())
+                    throw corrupted();
+
+                return atoms[id];
+            };
+
+            std::vector<size_t> line_starts(reader.read_count(sizeof(uint64_t)));
+
+            for (size_t i = 0; i < line_starts.size(); ++i) {
+                line_starts[i] = (size_t)reader.read<uint64_t>();
+
+                if (line_starts[i] > source->size() || (i == 0 ? line_starts[i] != 0 : line_starts[i] <= line_starts[i - 1]))
+                    throw corrupted();
+            }
+
+            if (line_starts.empty())
+                throw corrupted();
+
+            std::vector<std::shared_ptr<Chunk>> chunks(reader.read_count(1));
+            std::vector<std::vector<uint32_t>> function_indices(chunks.size());
+
+            if (chunks.empty())
+                throw corrupted();
+
+            for (size_t i = 0; i < chunks.size(); ++i) {
+                std::shared_ptr<Chunk> chunk(new Chunk());
+                chunk->atom_table = atom_table;
+
+                chunk->code.resize(reader.read_count(sizeof(unsigned int)));
+
+                // Lazy bodies have no code, and data() of an empty vector may be nullptr
+                if (!chunk->code.empty())
+                    memcpy(chunk->code.data(), reader.read_bytes(chunk->code.size() * sizeof(unsigned int)), chunk->code.size() * sizeof(unsigned int));
+
+                chunk->atoms.resize(reader.read_count(sizeof(uint32_t)));
+                for (size_t j = 0; j < chunk->atoms.size(); ++j)
+                    chunk->atoms[j] = read_atom();
+
+                uint32_t constant_count = reader.read_count(sizeof(ConstantKind));
+                for (uint32_t j = 0; j < constant_count; ++j) {
+                    switch (reader.read<ConstantKind>()) {
+                    case ConstantKind::INTEGER:
+                        chunk->add_constant(new Variable((long long)reader.read<int64_t>()));
+                        break;
+                    case ConstantKind::FLOAT:
+                        chunk->add_constant(new Variable(reader.read<double>()));
+                        break;
+                    case ConstantKind::STRING:
+                        chunk->add_constant(new Variable(reader.read_string(), Variable::VariableFlags::STRING));
+                        break;
+                    default:
+                        throw corrupted();
+                    }
+                }
+
+                // Functions always come after the chunk that defines them
+                function_indices[i].resize(reader.read_count(sizeof(uint32_t)));
+                for (size_t j = 0; j < function_indices[i].size(); ++j) {
+                    function_indices[i][j] = reader.read<uint32_t>();
+
+                    if (function_indices[i][j] <= i || function_indices[i][j] >= chunks.size())
+                        throw corrupted();
+                }
+
+                int32_t name = reader.read<int32_t>();
+                if (name >= (int32_t)atoms.size())
+                    throw corrupted();
+                chunk->name = name >= 0 ? atoms[name] : nullptr;
+
+                chunk->parameters.resize(reader.read_count(sizeof(uint32_t)));
+                for (size_t j = 0; j < chunk->parameters.size(); ++j)
+                    chunk->parameters[j] = read_atom();
+
+                chunk->source = reader.read_string();
+
+                // Lazy bodies are compiled from the script source, like the ones that were never cached
+                if (reader.read<uint8_t>())
+                    chunk->lazy_source = source;
+
+                chunk->lazy_begin = (size_t)reader.read<uint64_t>();
+                chunk->lazy_end = (size_t)reader.read<uint64_t>();
+
+                if (chunk->lazy_begin > chunk->lazy_end || chunk->lazy_end > source->size())
+                    throw corrupted();
+
+                // The code of a lazy body is compiled when it is first called, the program runs as is
+                if (chunk->lazy_source) {
+                    if (i == 0 || !chunk->code.empty())
+                        throw corrupted();
+                }
+                else {
+                    chunk->stack_size = verify_code(*chunk, function_indices[i].size());
+                }
+
+                chunks[i] = chunk;
+            }
+
+            if (!reader.at_end())
+                throw corrupted();
+
+            for (size_t i = chunks.size(); i-- > 0;) {
+                for (uint32_t index : function_indices[i])
+                    chunks[i]->functions.push_back(chunks[index]);
+            }
+
+            source->set_line_index(std::unique_ptr<LineIndex>(new LineIndex(std::move(line_starts))));
+
+            return std::unique_ptr<Script>(new Script(source, chunks[0]));
+        }
+        catch (const DeltaScriptException&) {
+            return nullptr;
+        }
+    }
+}  // namespace DeltaScript
@@ -0,0 +1,85 @@
+#include <DeltaScript/DeltaScript.h>
+
+namespace DeltaScript {
+    namespace {
+        // Shorter shapes are searched by walking up to the empty shape
+        const unsigned int max_linear_search = 8;
+
+        std::atomic<unsigned long long> last_id(0);
+        std::atomic<size_t> shape_count(0);
+    }
+
+    Shape::Shape()
+        : parent_(nullptr), hash_(0), slot_count_(0), id_(create_id()) {
+
+    }
+
+    Shape::Shape(const Shape* parent, const std::string& name, size_t hash)
+        : parent_(parent), name_(name), hash_(hash), slot_count_(parent->slot_count_ + 1), id_(create_id()) {
+
+    }
+
+    const Shape* Shape::get_empty() {
+        static const Shape* empty = new Shape();
+
+        return empty;
+    }
+
+    const Shape* Shape::add(const std::string& name, size_t hash) const {
+        std::lock_guard<std::mutex> lock(transitions_mutex_);
+        auto transition = transitions_.find(VariableKey{ name, hash });
+
+        if (transition != transitions_.end())
+            return transition->second;
+
+        if (shape_count.fetch_add(1, std::memory_order_relaxed) >= max_shapes) {
+            shape_count.fetch_sub(1, std::memory_order_relaxed);
+
+            return nullptr;
+        }
+
+        const Shape* shape = new Shape(this, name, hash);
+        transitions_[VariableKey{ shape->name_, hash }] = shape;
+
+        return shape;
+    }
+
+    const Shape* Shape::get_parent() const {
+        return parent_;
+    }
+
+    int Shape::find(std::string_view name, size_t hash) const {
+        if (slot_count_ <= max_linear_search) {
+            for (const Shape* shape = this; shape->parent_; shape = shape->parent_) {
+                if (shape->hash_ == hash && shape->name_ == name)
+                    return (int)shape->slot_count_ - 1;
+            }
+
+            return -1;
+        }
+
+        std::call_once(table_once_, [this]() {
+            table_.reset(new std::unordered_map<VariableKey, unsigned int, VariableKeyHash>());
+            table_->reserve(slot_count_);
+
+            for (const Shape* shape = this; shape->parent_; shape = shape->parent_)
+                (*table_)[VariableKey{ shape->name_, shape->hash_ }] = shape->slot_count_ - 1;
+            });
+
+        auto slot = table_->find(VariableKey{ name, hash });
+
+        return slot != table_->end() ? (int)slot->second : -1;
+    }
+
+    unsigned int Shape::get_slot_count() const {
+        return slot_count_;
+    }
+
+    unsigned long long Shape::get_id() const {
+        return id_;
+    }
+
+    unsigned long long Shape::create_id() {
+        return last_id.fetch_add(1, std::memory_order_relaxed) + 1;
+    }
+}  // namespace DeltaScript
@@ -0,0 +1,48 @@
+#include <DeltaScript/DeltaScript.h>
+
+namespace DeltaScript {
+    Source::Source() {
+        data_ = "";
+        size_ = 0;
+    }
+
+    std::shared_ptr<const Source> Source::from_string(std::string text) {
+        std::shared_ptr<Source> source(new Source());
+        source->text_ = std::move(text);
+        source->data_ = source->text_.data();
+        source->size_ = source->text_.size();
+
+        return source;
+    }
+
+    std::shared_ptr<const Source> Source::from_file(const std::string& path) {
+        std::shared_ptr<Source> source(new Source());
+        source->file_.reset(new MappedFile(path));
+        source->data_ = source->file_->data();
+        source->size_ = source->file_->size();
+
+        return source;
+    }
+
+    const char* Source::data() const {
+        return data_;
+    }
+
+    size_t Source::size() const {
+        return size_;
+    }
+
+    const LineIndex& Source::get_line_index() const {
+        std::call_once(line_index_once_, [this]() {
+            line_index_.reset(new LineIndex(data_, size_));
+            });
+
+        return *line_index_;
+    }
+
+    void Source::set_line_index(std::unique_ptr<LineIndex> line_index) const {
+        std::call_once(line_index_once_, [this, &line_index]() {
+            line_index_ = std::move(line_index);
+            });
+    }
+}  // namespace DeltaScript
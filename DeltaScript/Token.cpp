@@ -1,34 +1,59 @@
 #include <DeltaScript/DeltaScript.h>
 #include <sstream>
+#include <cstring>
+#include <algorithm>
 
 namespace DeltaScript {
-    std::string Token::get_position_info(const char* source, size_t source_length, int position) {
-        int line = 1, column = 1;
-        char c;
+    namespace {
+        // Reserved keywords in TokenKind order, AWAIT_K to YIELD_K
+        const char* const keyword_names[] = {
+            "await", "break", "case", "catch", "class", "const", "continue", "debugger", "default",
+            "delete", "do", "else", "export", "extends", "finally", "for", "function", "if", "import",
+            "in", "instanceof", "let", "new", "return", "static", "super", "switch", "this", "throw",
+            "try", "typeof", "undefined", "var", "void", "while", "with", "yield"
+        };
 
-        for (size_t i = 0; i < position; ++i) {
-            if (i < source_length) {
-                c = source[i];
-            }
-            else {
-                c = 0;
-            }
+        const size_t keyword_min_length = 2;
+        const size_t keyword_max_length = 10;
 
-            ++column;
+        // Perfect hash slots for keyword_names, generated offline by searching for multipliers
+        // that give every keyword a distinct slot: (length + first + second * 23) & 127.
+        // 255 marks an empty slot.
+        const unsigned char keyword_slots[128] = {
+            255, 255,  21, 255,  22, 255, 255, 255, 255, 255, 255,  23, 255, 255, 255, 255,
+            255, 255, 255, 255, 255,  17, 255,   0, 255, 255, 255, 255,   4,  11,   2,   3,
+            255, 255, 255, 255, 255,   1, 255, 255, 255, 255,  26, 255, 255, 255, 255, 255,
+             32, 255, 255,  12,  13,  29, 255, 255, 255, 255,  18, 255, 255, 255, 255, 255,
+            255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,  19, 255, 255,
+             27,  28, 255, 255,  34,  20, 255, 255, 255,  30, 255, 255,  14, 255, 255,  10,
+             31,   5,  15, 255,   6,  24, 255, 255, 255, 255,  35, 255, 255,  36, 255, 255,
+            255,  16, 255,  33, 255, 255, 255, 255, 255, 255, 255,  25, 255,   9,   8,   7,
+        };
+    }
 
-            if (Util::is_line_terminator(c)) {
-                ++line;
-                column = 0;
+    TokenKind Token::get_keyword_kind(const char* value, size_t length) {
+        if (length < keyword_min_length || length > keyword_max_length)
+            return TokenKind::IDENTIFIER;
 
-                if ((i + 1) < source_length && Util::is_line_terminator_crlf(c, source[i + 1]))
-                    ++i;
-            }
-        }
+        size_t hash = (length + (unsigned char)value[0] + (unsigned char)value[1] * 23) & 127;
+        unsigned char slot = keyword_slots[hash];
+
+        if (slot == 255)
+            return TokenKind::IDENTIFIER;
+
+        const char* name = keyword_names[slot];
 
-        std::ostringstream buf;
-        buf << "(line: " << line << ", column: " << column << ")";
+        if (strlen(name) != length || memcmp(name, value, length) != 0)
+            return TokenKind::IDENTIFIER;
+
+        return (TokenKind)((unsigned int)TokenKind::AWAIT_K + slot);
+    }
+
+    std::string Token::get_position_info(const char* source, size_t source_length, int position) {
+        // Only the source before the position matters, so index just that prefix
+        size_t prefix_length = position < 0 ? 0 : std::min(source_length, (size_t)position);
 
-        return buf.str();
+        return LineIndex(source, prefix_length).get_position_info(position);
     }
 
     std::string Token::get_token_kind_as_string(TokenKind kind) {
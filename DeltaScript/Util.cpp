@@ -1,7 +1,183 @@
 #include <DeltaScript/DeltaScript.h>
+#include <cstdint>
+#include <cstdlib>
+#include <climits>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define DELTASCRIPT_SSE2
+#include <emmintrin.h>
+#endif
+
+#if defined(__AVX2__)
+#define DELTASCRIPT_AVX2
+#include <immintrin.h>
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
 
 namespace DeltaScript {
     namespace Util {
+        namespace {
+            inline unsigned int count_trailing_zeros(uint32_t value) {
+#ifdef _MSC_VER
+                unsigned long index;
+                _BitScanForward(&index, value);
+
+                return (unsigned int)index;
+#else
+                return (unsigned int)__builtin_ctz(value);
+#endif
+            }
+
+            // Each scanner describes the bytes a scan stops at, once as a scalar test and once
+            // as a bit mask over a 16 or 32 byte block. scan() runs the widest kernel available
+            // and finishes the tail with the scalar test, so it never reads past end.
+
+            struct WhiteSpaceScanner {
+                bool stops_at(char value) const {
+                    return !value || !(is_white_space(value) || is_line_terminator(value));
+                }
+
+#ifdef DELTASCRIPT_SSE2
+                uint32_t stop_mask(__m128i block) const {
+                    // <TAB> <LF> <VT> <FF> <CR> are the contiguous range 0x09-0x0D
+                    __m128i offset = _mm_sub_epi8(block, _mm_set1_epi8(0x09));
+                    __m128i control = _mm_cmpeq_epi8(_mm_min_epu8(offset, _mm_set1_epi8(0x04)), offset);
+                    __m128i space = _mm_cmpeq_epi8(block, _mm_set1_epi8(' '));
+
+                    return ~(uint32_t)_mm_movemask_epi8(_mm_or_si128(control, space)) & 0xFFFF;
+                }
+#endif
+
+#ifdef DELTASCRIPT_AVX2
+                uint32_t stop_mask(__m256i block) const {
+                    __m256i offset = _mm256_sub_epi8(block, _mm256_set1_epi8(0x09));
+                    __m256i control = _mm256_cmpeq_epi8(_mm256_min_epu8(offset, _mm256_set1_epi8(0x04)), offset);
+                    __m256i space = _mm256_cmpeq_epi8(block, _mm256_set1_epi8(' '));
+
+                    return ~(uint32_t)_mm256_movemask_epi8(_mm256_or_si256(control, space));
+                }
+#endif
+            };
+
+            struct IdentifierScanner {
+                bool stops_at(char value) const {
+                    return !(is_alpha(value) || is_digit(value));
+                }
+
+#ifdef DELTASCRIPT_SSE2
+                uint32_t stop_mask(__m128i block) const {
+                    __m128i lower = _mm_sub_epi8(_mm_or_si128(block, _mm_set1_epi8(0x20)), _mm_set1_epi8('a'));
+                    __m128i alpha = _mm_cmpeq_epi8(_mm_min_epu8(lower, _mm_set1_epi8(25)), lower);
+                    __m128i digit_offset = _mm_sub_epi8(block, _mm_set1_epi8('0'));
+                    __m128i digit = _mm_cmpeq_epi8(_mm_min_epu8(digit_offset, _mm_set1_epi8(9)), digit_offset);
+                    __m128i underscore = _mm_cmpeq_epi8(block, _mm_set1_epi8('_'));
+
+                    return ~(uint32_t)_mm_movemask_epi8(_mm_or_si128(_mm_or_si128(alpha, digit), underscore)) & 0xFFFF;
+                }
+#endif
+
+#ifdef DELTASCRIPT_AVX2
+                uint32_t stop_mask(__m256i block) const {
+                    __m256i lower = _mm256_sub_epi8(_mm256_or_si256(block, _mm256_set1_epi8(0x20)), _mm256_set1_epi8('a'));
+                    __m256i alpha = _mm256_cmpeq_epi8(_mm256_min_epu8(lower, _mm256_set1_epi8(25)), lower);
+                    __m256i digit_offset = _mm256_sub_epi8(block, _mm256_set1_epi8('0'));
+                    __m256i digit = _mm256_cmpeq_epi8(_mm256_min_epu8(digit_offset, _mm256_set1_epi8(9)), digit_offset);
+                    __m256i underscore = _mm256_cmpeq_epi8(block, _mm256_set1_epi8('_'));
+
+                    return ~(uint32_t)_mm256_movemask_epi8(_mm256_or_si256(_mm256_or_si256(alpha, digit), underscore));
+                }
+#endif
+            };
+
+            // Stops at either of two bytes or at a NUL byte
+            struct CharacterScanner {
+                char first;
+                char second;
+
+                bool stops_at(char value) const {
+                    return !value || value == first || value == second;
+                }
+
+#ifdef DELTASCRIPT_SSE2
+                uint32_t stop_mask(__m128i block) const {
+                    __m128i found = _mm_or_si128(
+                        _mm_or_si128(_mm_cmpeq_epi8(block, _mm_set1_epi8(first)), _mm_cmpeq_epi8(block, _mm_set1_epi8(second))),
+                        _mm_cmpeq_epi8(block, _mm_setzero_si128()));
+
+                    return (uint32_t)_mm_movemask_epi8(found);
+                }
+#endif
+
+#ifdef DELTASCRIPT_AVX2
+                uint32_t stop_mask(__m256i block) const {
+                    __m256i found = _mm256_or_si256(
+                        _mm256_or_si256(_mm256_cmpeq_epi8(block, _mm256_set1_epi8(first)), _mm256_cmpeq_epi8(block, _mm256_set1_epi8(second))),
+                        _mm256_cmpeq_epi8(block, _mm256_setzero_si256()));
+
+                    return (uint32_t)_mm256_movemask_epi8(found);
+                }
+#endif
+            };
+
+            template<typename Scanner>
+            size_t scan(const Scanner& scanner, const char* source, size_t position, size_t end) {
+#ifdef DELTASCRIPT_AVX2
+                while (position + 32 <= end) {
+                    uint32_t mask = scanner.stop_mask(_mm256_loadu_si256((const __m256i*)&source[position]));
+
+                    if (mask)
+                        return position + count_trailing_zeros(mask);
+
+                    position += 32;
+                }
+#endif
+#ifdef DELTASCRIPT_SSE2
+                while (position + 16 <= end) {
+                    uint32_t mask = scanner.stop_mask(_mm_loadu_si128((const __m128i*)&source[position]));
+
+                    if (mask)
+                        return position + count_trailing_zeros(mask);
+
+                    position += 16;
+                }
+#endif
+                while (position < end && !scanner.stops_at(source[position]))
+                    ++position;
+
+                return position;
+            }
+        }
+
+        size_t skip_white_space(const char* source, size_t position, size_t end) {
+            return scan(WhiteSpaceScanner(), source, position, end);
+        }
+
+        size_t skip_identifier(const char* source, size_t position, size_t end) {
+            return scan(IdentifierScanner(), source, position, end);
+        }
+
+        size_t find_line_end(const char* source, size_t position, size_t end) {
+            return scan(CharacterScanner{ '\n', '\n' }, source, position, end);
+        }
+
+        size_t find_multiline_comment_end(const char* source, size_t position, size_t end) {
+            while (true) {
+                position = scan(CharacterScanner{ '*', '*' }, source, position, end);
+
+                if (position >= end || !source[position] || (position + 1 < end && source[position + 1] == '/'))
+                    return position;
+
+                ++position;
+            }
+        }
+
+        size_t find_string_literal_end(const char* source, size_t position, size_t end, char quote) {
+            return scan(CharacterScanner{ quote, '\\' }, source, position, end);
+        }
+
         bool is_white_space(char value) {
             return value == 0x0009 /*<TAB>*/ || value == 0x000B /*<VT>*/ || value == 0x000C /*<FF>*/
                 || value == 0x0020 /*<SP>*/ || value == 0x00A0 /*<NBSP>*/;
@@ -35,6 +211,121 @@ namespace DeltaScript {
             return true;
         }
 
+        long long parse_integer_literal(const char* value, size_t length) {
+            size_t i = 0;
+            unsigned long long result = 0;
+            unsigned long long limit = (unsigned long long)LLONG_MAX;
+
+            if (length >= 2 && value[0] == '0' && value[1] == 'x') {
+                for (i = 2; i < length && is_hex(value[i]); ++i) {
+                    unsigned int digit = is_digit(value[i]) ? value[i] - '0' : (value[i] | 0x20) - 'a' + 10;
+
+                    if (result > (limit - digit) / 16)
+                        return LLONG_MAX;
+
+                    result = result * 16 + digit;
+                }
+            }
+            else if (length >= 2 && value[0] == '0') {
+                // A leading zero keeps selecting octal, as strtol with base 0 did
+                for (i = 1; i < length && value[i] >= '0' && value[i] <= '7'; ++i) {
+                    unsigned int digit = value[i] - '0';
+
+                    if (result > (limit - digit) / 8)
+                        return LLONG_MAX;
+
+                    result = result * 8 + digit;
+                }
+            }
+            else {
+                for (i = 0; i < length && is_digit(value[i]); ++i) {
+                    unsigned int digit = value[i] - '0';
+
+                    if (result > (limit - digit) / 10)
+                        return LLONG_MAX;
+
+                    result = result * 10 + digit;
+                }
+            }
+
+            return (long long)result;
+        }
+
+        double parse_float_literal(const char* value, size_t length) {
+            // Exact powers of ten representable as doubles
+            static const double powers_of_ten[] = {
+                1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+                1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+            };
+
+            size_t i = 0;
+            unsigned long long mantissa = 0;
+            int digits = 0;
+            int exponent = 0;
+
+            for (; i < length && is_digit(value[i]); ++i) {
+                if (mantissa || value[i] != '0')
+                    ++digits;
+
+                mantissa = mantissa * 10 + (value[i] - '0');
+            }
+
+            if (i < length && value[i] == '.') {
+                for (++i; i < length && is_digit(value[i]); ++i) {
+                    if (mantissa || value[i] != '0')
+                        ++digits;
+
+                    mantissa = mantissa * 10 + (value[i] - '0');
+                    --exponent;
+                }
+            }
+
+            if (i < length && (value[i] == 'e' || value[i] == 'E')) {
+                bool negative = false;
+                int explicit_exponent = 0;
+
+                ++i;
+
+                if (i < length && (value[i] == '+' || value[i] == '-')) {
+                    negative = value[i] == '-';
+                    ++i;
+                }
+
+                for (; i < length && is_digit(value[i]); ++i) {
+                    if (explicit_exponent < 100000)
+                        explicit_exponent = explicit_exponent * 10 + (value[i] - '0');
+                }
+
+                exponent += negative ? -explicit_exponent : explicit_exponent;
+            }
+
+            // Clinger's fast path: a mantissa that fits in 53 bits scaled by an exact power of ten
+            // rounds correctly with a single multiplication or division
+            if (digits <= 19 && mantissa <= (1ULL << 53) && exponent >= -22 && exponent <= 22) {
+                double result = (double)mantissa;
+
+                if (exponent < 0)
+                    return result / powers_of_ten[-exponent];
+
+                return result * powers_of_ten[exponent];
+            }
+
+            return strtod(std::string(value, length).c_str(), 0);
+        }
+
+        size_t hash_name(std::string_view name) {
+            return std::hash<std::string_view>()(name);
+        }
+
+        uint64_t hash_bytes(const char* data, size_t length, uint64_t hash) {
+            for (size_t i = 0; i < length; ++i) {
+                hash ^= (unsigned char)data[i];
+                hash *= 1099511628211ULL;
+            }
+
+            return hash;
+        }
+
         bool is_hex(char value) {
             return (value >= '0' && value <= '9')
                 || (value >= 'a' && value <= 'f')
@@ -9,8 +9,8 @@
 namespace DeltaScript {
     Variable::Variable() {
         ref_count_ = 0;
-        last_child_ = nullptr;
-        first_child_ = nullptr;
+        shape_ = Shape::get_empty();
+        layout_ = 0;
         str_data_ = "";
         int_data_ = 0;
         double_data_ = 0;
@@ -28,7 +28,7 @@ namespace DeltaScript {
         flags_ = var_flags;
 
         if (flags_ & VariableFlags::INTEGER) {
-            int_data_ = strtol(data.c_str(), 0, 0);
+            int_data_ = strtoll(data.c_str(), 0, 0);
         }
         else if (flags_ & VariableFlags::DOUBLE) {
             double_data_ = strtod(data.c_str(), 0);
@@ -42,6 +42,11 @@ namespace DeltaScript {
         set_int(value);
     }
 
+    Variable::Variable(long long value) : Variable() {
+        flags_ = VariableFlags::INTEGER;
+        int_data_ = value;
+    }
+
     Variable::Variable(double value) : Variable() {
         set_double(value);
     }
@@ -72,7 +77,7 @@ namespace DeltaScript {
 
     int Variable::get_int() const {
         if (is_int())
-            return int_data_;
+            return (int)int_data_;
 
         if (is_null() || is_undefined())
             return 0;
@@ -101,6 +106,7 @@ namespace DeltaScript {
         str_data_ = value;
         int_data_ = 0;
         double_data_ = 0;
+        function_code_.reset();
     }
 
     void Variable::set_int(int value) {
@@ -108,6 +114,7 @@ namespace DeltaScript {
         int_data_ = value;
         double_data_ = 0;
         str_data_ = "";
+        function_code_.reset();
     }
 
     void Variable::set_double(double value) {
@@ -115,6 +122,7 @@ namespace DeltaScript {
         double_data_ = value;
         int_data_ = 0;
         str_data_ = "";
+        function_code_.reset();
     }
 
     void Variable::set_undefined() {
@@ -123,6 +131,7 @@ namespace DeltaScript {
         double_data_ = 0;
         str_data_ = "";
         remove_all_children();
+        function_code_.reset();
     }
 
     void Variable::set_as_array() {
@@ -131,6 +140,7 @@ namespace DeltaScript {
         double_data_ = 0;
         str_data_ = "";
         remove_all_children();
+        function_code_.reset();
     }
 
     bool Variable::is_int() const {
@@ -174,17 +184,30 @@ namespace DeltaScript {
     }
 
     bool Variable::is_basic() const {
-        return children_.empty();
+        return get_children_count() == 0;
+    }
+
+    bool Variable::is_constant() const {
+        return (flags_ & VariableFlags::CONSTANT) != 0;
+    }
+
+    void Variable::set_constant() {
+        flags_ |= VariableFlags::CONSTANT;
     }
 
     VariableReference* Variable::find_child(const std::string& child_name) const {
-        static int i = 0;
-        ++i;
+        return find_child(child_name, Util::hash_name(child_name));
+    }
+
+    VariableReference* Variable::find_child(const Atom& child_name) const {
+        return find_child(child_name.name, child_name.hash);
+    }
 
-        auto c = children_.find(child_name);
+    VariableReference* Variable::find_child(std::string_view child_name, size_t hash) const {
+        int slot = find_slot(child_name, hash);
 
-        if (c != children_.end())
-            return c->second;
+        if (slot >= 0)
+            return slots_[slot];
 
         if (child_name == "length") {
             if (is_array()) {
@@ -207,6 +230,15 @@ namespace DeltaScript {
         return add_child(child_name, new Variable("", var_flags));
     }
 
+    VariableReference* Variable::find_child_or_create(const Atom& child_name, unsigned int var_flags) {
+        VariableReference* ref = find_child(child_name);
+
+        if (ref)
+            return ref;
+
+        return add_child(child_name.name, child_name.hash, new Variable("", var_flags));
+    }
+
     VariableReference* Variable::find_child_or_create_by_path(const std::string& path) {
         size_t p = path.find('.');
         if (p == std::string::npos)
@@ -217,6 +249,14 @@ namespace DeltaScript {
     }
 
     VariableReference* Variable::add_child(const std::string& child_name, Variable* child) {
+        return add_child(child_name, Util::hash_name(child_name), child);
+    }
+
+    VariableReference* Variable::add_child(const Atom& child_name, Variable* child) {
+        return add_child(child_name.name, child_name.hash, child);
+    }
+
+    VariableReference* Variable::add_child(const std::string& child_name, size_t hash, Variable* child) {
         if (is_undefined())
             flags_ = VariableFlags::OBJECT;
 
@@ -226,28 +266,61 @@ namespace DeltaScript {
         VariableReference* ref = new VariableReference(child, child_name);
         ref->owner = true;
 
-        if (!children_.empty()) {
-            VariableReference* old_child = find_child(child_name);
+        int slot = find_slot(child_name, hash);
 
-            if (old_child) {
-                old_child->replace_with(ref);
-                delete ref;
+        if (slot >= 0) {
+            VariableReference* old_child = slots_[slot];
+            old_child->replace_with(ref);
+            delete ref;
 
-                return old_child;
-            }
-            else {
-                last_child_->next_sibling = ref;
-                ref->prev_sibling = last_child_;
-                last_child_ = ref;
+            return old_child;
+        }
 
-                return children_[child_name] = ref;
-            }
+        const Shape* shape = nullptr;
+
+        if (shape_ && shape_->get_slot_count() < Shape::max_slots)
+            shape = shape_->add(ref->name, hash);
+
+        if (shape) {
+            shape_ = shape;
         }
         else {
-            last_child_ = first_child_ = ref;
+            to_dictionary();
+            (*dictionary_)[VariableKey{ ref->name, hash }] = (unsigned int)slots_.size();
+            layout_ = 0;
+        }
+
+        if (slots_.empty())
+            slots_.reserve(4);
+
+        slots_.push_back(ref);
+
+        return ref;
+    }
+
+    int Variable::find_slot(std::string_view child_name, size_t hash) const {
+        if (shape_)
+            return shape_->find(child_name, hash);
+
+        auto slot = dictionary_->find(VariableKey{ child_name, hash });
+
+        return slot != dictionary_->end() ? (int)slot->second : -1;
+    }
+
+    void Variable::to_dictionary() {
+        if (!shape_)
+            return;
 
-            return children_[child_name] = ref;
+        dictionary_.reset(new std::unordered_map<VariableKey, unsigned int, VariableKeyHash>());
+        dictionary_->reserve(slots_.size());
+
+        for (size_t i = 0; i < slots_.size(); ++i) {
+            const std::string& name = slots_[i]->name;
+            (*dictionary_)[VariableKey{ name, Util::hash_name(name) }] = (unsigned int)i;
         }
+
+        shape_ = nullptr;
+        layout_ = 0;
     }
 
     void Variable::remove_child(const std::string& child_name, Variable* child, bool throw_if_not_found) {
@@ -265,35 +338,49 @@ namespace DeltaScript {
         if (!ref)
             return;
 
-        if (!children_.erase(ref->name))
-            throw VariableReferenceException("Cannot remove reference that does not exist in that variable");
+        size_t hash = Util::hash_name(ref->name);
+        int slot = find_slot(ref->name, hash);
 
-        if (ref->next_sibling)
-            ref->next_sibling->prev_sibling = ref->prev_sibling;
-
-        if (ref->prev_sibling)
-            ref->prev_sibling->next_sibling = ref->next_sibling;
+        if (slot < 0)
+            throw VariableReferenceException("Cannot remove reference that does not exist in that variable");
 
-        if (first_child_ == ref)
-            first_child_ = ref->next_sibling;
+        // Removing the last child goes back one transition, any other turns the shape into a dictionary
+        if (shape_ && (size_t)slot == slots_.size() - 1) {
+            shape_ = shape_->get_parent();
+            slots_.pop_back();
+        }
+        else {
+            to_dictionary();
+            dictionary_->erase(VariableKey{ ref->name, hash });
+            slots_[slot] = nullptr;
+            layout_ = 0;
+
+            // Drops the empty slots once they are the majority
+            if (dictionary_->size() * 2 < slots_.size()) {
+                size_t count = 0;
+
+                for (VariableReference* child : slots_) {
+                    if (child) {
+                        (*dictionary_)[VariableKey{ child->name, Util::hash_name(child->name) }] = (unsigned int)count;
+                        slots_[count++] = child;
+                    }
+                }
 
-        if (last_child_ == ref)
-            last_child_ = ref->prev_sibling;
+                slots_.resize(count);
+            }
+        }
 
         delete ref;
     }
 
     void Variable::remove_all_children() {
-        auto it = children_.begin();
-        while (it != children_.end()) {
-            VariableReference* temp = it->second;
-            it = children_.erase(it);
+        for (VariableReference* child : slots_)
+            delete child;
 
-            delete temp;
-        }
-
-        first_child_ = nullptr;
-        last_child_ = nullptr;
+        slots_.clear();
+        shape_ = Shape::get_empty();
+        dictionary_.reset();
+        layout_ = 0;
     }
 
     Variable* Variable::get_array_val_at_index(int index) const {
@@ -336,10 +423,8 @@ namespace DeltaScript {
 
         int highest = -1;
 
-        for (auto& child : children_) {
-            VariableReference* ref = child.second;
-
-            if (Util::is_number(ref->name)) {
+        for (VariableReference* ref : slots_) {
+            if (ref && Util::is_number(ref->name)) {
                 int val = atoi(ref->name.c_str());
 
                 if (val > highest)
@@ -351,11 +436,28 @@ namespace DeltaScript {
     }
 
     int Variable::get_children_count() const {
-        return (int)children_.size();
+        return shape_ ? (int)slots_.size() : (int)dictionary_->size();
     }
     
+    unsigned long long Variable::get_layout() {
+        if (shape_)
+            return shape_->get_id();
+
+        if (!layout_)
+            layout_ = Shape::create_id();
+
+        return layout_;
+    }
+
     std::unordered_map<std::string, VariableReference*> Variable::get_children() const {
-        return children_;
+        std::unordered_map<std::string, VariableReference*> children;
+
+        for (VariableReference* child : slots_) {
+            if (child)
+                children[child->name] = child;
+        }
+
+        return children;
     }
 
     Variable* Variable::execute_math_operation(Variable* second, TokenKind operation) {
@@ -513,20 +615,7 @@ namespace DeltaScript {
         if (value) {
             copy_simple_data_from(value);
             remove_all_children();
-
-            for (auto& it : value->children_) {
-                VariableReference* child = it.second;
-                Variable* copy;
-
-                if (it.first != "prototype") {
-                    copy = child->var->deep_copy();
-                }
-                else {
-                    copy = child->var;
-                }
-
-                add_child(it.first, copy);
-            }
+            copy_children_from(value);
         }
         else {
             set_undefined();
@@ -535,6 +624,7 @@ namespace DeltaScript {
 
     void Variable::copy_simple_data_from(Variable* value) {
         str_data_ = value->str_data_;
+        function_code_ = value->function_code_;
         int_data_ = value->int_data_;
         double_data_ = value->double_data_;
         flags_ = (flags_ & ~VariableFlags::VARTYPE) | (value->flags_ & VariableFlags::VARTYPE);
@@ -544,9 +634,27 @@ namespace DeltaScript {
         Variable* new_var = new Variable();
 
         new_var->copy_simple_data_from(this);
+        new_var->copy_children_from(this);
+
+        return new_var;
+    }
+
+    void Variable::copy_children_from(const Variable* value) {
+        // A copy of a variable with a shape takes the same shape, and the children the same slots
+        bool same_shape = value->shape_ && !value->slots_.empty();
+
+        if (same_shape) {
+            if (is_undefined())
+                flags_ = VariableFlags::OBJECT;
+
+            shape_ = value->shape_;
+            slots_.reserve(value->slots_.size());
+        }
+
+        for (VariableReference* child : value->slots_) {
+            if (!child)
+                continue;
 
-        for (auto& it : children_) {
-            VariableReference* child = it.second;
             Variable* copy;
 
             if (child->name != "prototype") {
@@ -556,10 +664,15 @@ namespace DeltaScript {
                 copy = child->var;
             }
 
-            new_var->add_child(child->name, copy);
+            if (same_shape) {
+                VariableReference* ref = new VariableReference(copy, child->name);
+                ref->owner = true;
+                slots_.push_back(ref);
+            }
+            else {
+                add_child(child->name, copy);
+            }
         }
-
-        return new_var;
     }
 
     Variable* Variable::inc_ref() {
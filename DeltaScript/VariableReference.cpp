@@ -8,27 +8,21 @@ namespace DeltaScript {
     }
 
     VariableReference::VariableReference()
-        : next_sibling(nullptr),
-        prev_sibling(nullptr),
-        var(nullptr),
+        : var(nullptr),
         owner(false),
         name("") {
 
     }
 
     VariableReference::VariableReference(Variable* var, const std::string& name)
-        : next_sibling(nullptr),
-        prev_sibling(nullptr),
-        var(var->inc_ref()),
+        : var(var->inc_ref()),
         owner(false),
         name(name) {
 
     }
 
     VariableReference::VariableReference(const VariableReference& value)
-        : next_sibling(value.next_sibling),
-        prev_sibling(value.prev_sibling),
-        var(value.var->inc_ref()),
+        : var(value.var->inc_ref()),
         owner(false),
         name(value.name) {
 
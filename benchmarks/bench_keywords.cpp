@@ -0,0 +1,74 @@
+#include <DeltaScript/DeltaScript.h>
+#include <chrono>
+#include <cstdlib>
+#include <vector>
+#include <iostream>
+
+using DeltaScript::TokenKind;
+
+// Sequential comparison chain the lexer used before keyword lookup was hashed, kept as the baseline
+static TokenKind classify_sequential(const std::string& value) {
+    static const char* const names[] = {
+        "await", "break", "case", "catch", "class", "const", "continue", "debugger", "default",
+        "delete", "do", "else", "export", "extends", "finally", "for", "function", "if", "import",
+        "in", "instanceof", "let", "new", "return", "static", "super", "switch", "this", "throw",
+        "try", "typeof", "undefined", "var", "void", "while", "with", "yield"
+    };
+
+    for (unsigned int i = 0; i < sizeof(names) / sizeof(names[0]); ++i) {
+        if (value == names[i])
+            return (TokenKind)((unsigned int)TokenKind::AWAIT_K + i);
+    }
+
+    return TokenKind::IDENTIFIER;
+}
+
+static TokenKind classify_hashed(const std::string& value) {
+    return DeltaScript::Token::get_keyword_kind(value.data(), value.size());
+}
+
+template<typename Classifier>
+static double run(const std::vector<std::string>& identifiers, int rounds, Classifier classify, unsigned long& checksum) {
+    auto start = std::chrono::steady_clock::now();
+
+    for (int round = 0; round < rounds; ++round) {
+        for (auto& identifier : identifiers)
+            checksum += (unsigned int)classify(identifier);
+    }
+
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    return elapsed.count();
+}
+
+int main(int argc, char** argv) {
+    int rounds = argc > 1 ? atoi(argv[1]) : 20000;
+
+    // Roughly the mix of a typical script: mostly user identifiers, some keywords
+    std::vector<std::string> identifiers = {
+        "var", "i", "count", "function", "result", "return", "value", "if", "else", "total",
+        "index", "for", "while", "item", "items", "length", "x", "y", "print", "JSON",
+        "parse", "stringify", "undefined", "config", "node", "this", "new", "data", "key", "fib",
+        "n", "sum", "break", "continue", "update_score", "weight", "threshold", "instanceof", "typeof", "tmp"
+    };
+
+    unsigned long before_checksum = 0, after_checksum = 0;
+
+    double before = run(identifiers, rounds, classify_sequential, before_checksum);
+    double after = run(identifiers, rounds, classify_hashed, after_checksum);
+
+    if (before_checksum != after_checksum) {
+        std::cout << "Keyword classification mismatch" << std::endl;
+
+        return 1;
+    }
+
+    double count = (double)identifiers.size() * rounds;
+
+    std::cout << "identifiers: " << (unsigned long)count << std::endl;
+    std::cout << "sequential: " << count / before / 1e6 << " M identifiers/s" << std::endl;
+    std::cout << "perfect hash: " << count / after / 1e6 << " M identifiers/s" << std::endl;
+    std::cout << "speedup: " << before / after << "x" << std::endl;
+
+    return 0;
+}
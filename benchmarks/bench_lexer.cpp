@@ -0,0 +1,172 @@
+#include <DeltaScript/DeltaScript.h>
+#include <nlohmann/json.hpp>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+// Front-end throughput benchmark: lexes synthetic and recorded scripts and walks them through
+// Context::check_syntax. Each measurement is printed as one JSON object per line.
+
+struct Input {
+    std::string name;
+    std::string source;
+};
+
+static std::string repeat_to_size(const std::function<std::string(int)>& statement, size_t size) {
+    std::string source;
+    int i = 0;
+
+    while (source.size() < size)
+        source += statement(i++);
+
+    return source;
+}
+
+static std::vector<Input> synthetic_inputs(size_t size) {
+    std::vector<Input> inputs;
+
+    inputs.push_back({ "identifiers", repeat_to_size([](int i) {
+        return "total_value_" + std::to_string(i % 97) + " = first_operand + second_operand_" + std::to_string(i % 13) + ";\n";
+        }, size) });
+
+    inputs.push_back({ "numbers", repeat_to_size([](int i) {
+        return "x = " + std::to_string(i) + " + 4.5e-3 * 0x1F - 1024.125 / " + std::to_string(i % 89 + 1) + ";\n";
+        }, size) });
+
+    inputs.push_back({ "strings", repeat_to_size([](int i) {
+        return "s = 'configuration value number " + std::to_string(i) + "' + \"with an escaped\\n line\";\n";
+        }, size) });
+
+    inputs.push_back({ "comments", repeat_to_size([](int i) {
+        return "// generated entry " + std::to_string(i) + ", documented at length for the reader\n"
+            "/* block comment spanning\n   a couple of lines */ x = 1;\n";
+        }, size) });
+
+    inputs.push_back({ "punctuators", repeat_to_size([](int) {
+        return "a = (b[c] + d) * e % f - (g << 2) >= h && i != j || !k;\n";
+        }, size) });
+
+    inputs.push_back({ "mixed", repeat_to_size([](int i) {
+        std::string n = std::to_string(i);
+
+        return "function handler_" + n + "(request, limit) {\n"
+            "    // Accumulate the weighted score\n"
+            "    var score = 0;\n"
+            "    for (var i = 0; i < limit; i++) { score = score + request.weight * 1.5; }\n"
+            "    if (score > " + n + ") { return 'accepted'; } else { return \"rejected\"; }\n"
+            "}\n";
+        }, size) });
+
+    return inputs;
+}
+
+static double best_of(int repeat, const std::function<void()>& run) {
+    double best = 0;
+
+    for (int i = 0; i < repeat; ++i) {
+        auto start = std::chrono::steady_clock::now();
+        run();
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+        if (i == 0 || elapsed.count() < best)
+            best = elapsed.count();
+    }
+
+    return best;
+}
+
+static void bench_lexer(const Input& input, int repeat) {
+    size_t tokens = 0;
+
+    double seconds = best_of(repeat, [&]() {
+        DeltaScript::Lexer lex(input.source);
+        tokens = lex.get_token_count();
+        });
+
+    nlohmann::json result = {
+        { "benchmark", "lexer" },
+        { "input", input.name },
+        { "bytes", input.source.size() },
+        { "tokens", tokens },
+        { "seconds", seconds },
+        { "mb_per_s", input.source.size() / seconds / 1e6 },
+        { "tokens_per_s", tokens / seconds },
+    };
+
+    std::cout << result.dump() << std::endl;
+}
+
+static void bench_parse(const Input& input, int repeat) {
+    size_t statements = 0;
+    std::string error;
+
+    double seconds = best_of(repeat, [&]() {
+        DeltaScript::Context ctx;
+
+        try {
+            statements = ctx.check_syntax(input.source);
+        }
+        catch (DeltaScript::DeltaScriptException& e) {
+            error = e.message;
+        }
+        });
+
+    nlohmann::json result = {
+        { "benchmark", "parse" },
+        { "input", input.name },
+        { "bytes", input.source.size() },
+        { "statements", statements },
+        { "seconds", seconds },
+        { "mb_per_s", input.source.size() / seconds / 1e6 },
+        { "statements_per_s", statements / seconds },
+    };
+
+    if (!error.empty())
+        result["error"] = error;
+
+    std::cout << result.dump() << std::endl;
+}
+
+int main(int argc, char** argv) {
+    size_t size = 4 * 1024 * 1024;
+    int repeat = 5;
+    std::vector<Input> inputs;
+
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--size-mb") == 0 && i + 1 < argc) {
+            size = (size_t)(atof(argv[++i]) * 1024 * 1024);
+        }
+        else if (strcmp(argv[i], "--repeat") == 0 && i + 1 < argc) {
+            repeat = atoi(argv[++i]);
+        }
+        else {
+            std::ifstream file(argv[i], std::ios::in | std::ios::binary);
+
+            if (!file) {
+                std::cerr << "Unable to open " << argv[i] << std::endl;
+
+                return 1;
+            }
+
+            std::ostringstream contents;
+            contents << file.rdbuf();
+
+            inputs.push_back({ argv[i], contents.str() });
+        }
+    }
+
+    if (inputs.empty())
+        inputs = synthetic_inputs(size);
+
+    for (auto& input : inputs) {
+        bench_lexer(input, repeat);
+        bench_parse(input, repeat);
+    }
+
+    return 0;
+}
@@ -0,0 +1,20 @@
+#include <DeltaScript/DeltaScript.h>
+#include <iostream>
+#include "aot_example.h"
+
+int main() {
+    DeltaScript::Context ctx;
+    ctx.add_native_function("function print(str)", [](DeltaScript::Variable* var, void*) {
+        std::cout << var->find_child("str")->var->get_string() << std::endl;
+        }, nullptr);
+
+    try {
+        DeltaScriptAot::execute_aot_example(ctx);
+    }
+    catch (DeltaScript::DeltaScriptException & e) {
+        std::cout << "[Caught DeltaScriptException]:" << std::endl;
+        std::cout << e.message << std::endl;
+    }
+
+    return 0;
+}
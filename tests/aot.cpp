@@ -0,0 +1,67 @@
+#include <DeltaScript/DeltaScript.h>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <sstream>
+
+#include "aot_program.h"
+
+// Runs tests/aot/aot_program.ds with its functions compiled ahead of time, and again in the
+// interpreter, and compares the output
+namespace {
+    void add_print(DeltaScript::Context& context, std::stringstream& output) {
+        context.add_native_function("function print(str)", [](DeltaScript::Variable* var, void* data) {
+            *(std::stringstream*)data << var->find_child("str")->var->get_string() << std::endl;
+            }, &output);
+    }
+
+    std::string run(const std::function<void(DeltaScript::Context&)>& execute) {
+        std::stringstream output;
+        DeltaScript::Context context;
+        add_print(context, output);
+
+        try {
+            execute(context);
+        }
+        catch (DeltaScript::DeltaScriptException& e) {
+            output << "[Caught DeltaScriptException]: " << e.message << std::endl;
+        }
+
+        return output.str();
+    }
+}
+
+int main(int argc, char** argv) {
+    if (argc != 2) {
+        std::cerr << "Usage: " << argv[0] << " <aot_program.ds>" << std::endl;
+
+        return 2;
+    }
+
+    std::ifstream file(argv[1], std::ios::binary);
+
+    if (!file) {
+        std::cerr << "Can not open " << argv[1] << std::endl;
+
+        return 2;
+    }
+
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+    std::string text = buffer.str();
+
+    std::string reference = run([&](DeltaScript::Context& context) { context.execute(text); });
+    std::string output = run([](DeltaScript::Context& context) { DeltaScriptAot::execute_aot_program(context); });
+
+    if (output != reference) {
+        std::cerr << "The compiled functions of " << argv[1] << " run differently" << std::endl
+            << "--- interpreter" << std::endl << reference
+            << "--- aot" << std::endl << output;
+
+        return 1;
+    }
+
+    std::cout << reference;
+
+    return 0;
+}
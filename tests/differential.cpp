@@ -0,0 +1,135 @@
+#include <DeltaScript/DeltaScript.h>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+// Runs a script once per configuration and fails if any run prints something else than the
+// first, which takes the generic path everywhere, or if that differs from the expected output
+namespace {
+    struct Configuration {
+        const char* name;
+        bool specialization_enabled;
+        bool jit_enabled;
+        int jit_threshold;
+        // Runs the script on another context first, so the type feedback and inline caches
+        // of the shared chunks are already filled in
+        bool warm;
+    };
+
+    const Configuration configurations[] = {
+        { "generic interpreter", false, false, 0, false },
+        { "specialized interpreter", true, false, 0, false },
+        { "specialized interpreter, warmed up by another context", true, false, 0, true },
+        { "jit after two calls", true, true, 2, false },
+        { "jit from the first call", true, true, 0, false },
+    };
+
+    std::string run_on(const DeltaScript::Script& script, const Configuration& configuration) {
+        std::stringstream output;
+        DeltaScript::Context context;
+        context.set_specialization_enabled(configuration.specialization_enabled);
+        context.set_jit_enabled(configuration.jit_enabled);
+        context.set_jit_threshold(configuration.jit_threshold);
+
+        context.add_native_function("function print(str)", [](DeltaScript::Variable* var, void* data) {
+            *(std::stringstream*)data << var->find_child("str")->var->get_string() << std::endl;
+            }, &output);
+        // Scripts have no array literals yet
+        context.add_native_function("function array()", [](DeltaScript::Variable* var, void*) {
+            var->find_child("return")->var->set_as_array();
+            }, nullptr);
+
+        try {
+            context.execute(script);
+        }
+        catch (DeltaScript::DeltaScriptException& e) {
+            output << "[Caught DeltaScriptException]: " << e.message << std::endl;
+        }
+
+        return output.str();
+    }
+
+    std::string run(const std::string& text, const Configuration& configuration) {
+        try {
+            DeltaScript::Context compiler;
+            DeltaScript::Script script = compiler.compile(text);
+
+            if (configuration.warm)
+                run_on(script, configuration);
+
+            return run_on(script, configuration);
+        }
+        catch (DeltaScript::DeltaScriptException& e) {
+            return "[Caught DeltaScriptException]: " + e.message + "\n";
+        }
+    }
+}
+
+namespace {
+    bool read_file(const char* path, std::string& text) {
+        std::ifstream file(path, std::ios::binary);
+
+        if (!file) {
+            std::cerr << "Can not open " << path << std::endl;
+
+            return false;
+        }
+
+        std::stringstream buffer;
+        buffer << file.rdbuf();
+        text = buffer.str();
+
+        return true;
+    }
+}
+
+int main(int argc, char** argv) {
+    if (argc != 2 && argc != 3) {
+        std::cerr << "Usage: " << argv[0] << " <script.ds> [expected output]" << std::endl;
+
+        return 2;
+    }
+
+    std::string script;
+
+    if (!read_file(argv[1], script))
+        return 2;
+
+    std::string reference = run(script, configurations[0]);
+    int result = 0;
+
+    if (argc == 3) {
+        std::string expected;
+
+        if (!read_file(argv[2], expected))
+            return 2;
+
+        if (reference != expected) {
+            std::cerr << argv[1] << ": " << configurations[0].name << " differs from " << argv[2] << std::endl
+                << "--- " << argv[2] << std::endl << expected
+                << "--- " << configurations[0].name << std::endl << reference;
+
+            result = 1;
+        }
+    }
+    else if (reference.empty()) {
+        std::cerr << argv[1] << " printed nothing" << std::endl;
+
+        return 1;
+    }
+
+    for (size_t i = 1; i < sizeof(configurations) / sizeof(configurations[0]); ++i) {
+        std::string output = run(script, configurations[i]);
+
+        if (output != reference) {
+            std::cerr << argv[1] << ": " << configurations[i].name << " differs from "
+                << configurations[0].name << std::endl
+                << "--- " << configurations[0].name << std::endl << reference
+                << "--- " << configurations[i].name << std::endl << output;
+
+            result = 1;
+        }
+    }
+
+    return result;
+}
@@ -0,0 +1,354 @@
+#include <DeltaScript/DeltaScript.h>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <sstream>
+
+// Writes a script to a cache entry, checks the entry loads and runs like a fresh compile, then
+// checks that damaged and crafted entries are rejected. Crafted entries get a valid checksum,
+// so only the checks of the contents can catch them.
+namespace {
+    // Offsets in CacheHeader, see ScriptCache.cpp
+    const size_t header_size = 88;
+    const size_t payload_size_offset = 72;
+    const size_t payload_checksum_offset = 80;
+
+    std::string run(const DeltaScript::Script& script) {
+        std::stringstream output;
+        DeltaScript::Context context;
+
+        context.add_native_function("function print(str)", [](DeltaScript::Variable* var, void* data) {
+            *(std::stringstream*)data << var->find_child("str")->var->get_string() << std::endl;
+            }, &output);
+
+        try {
+            context.execute(script);
+        }
+        catch (DeltaScript::DeltaScriptException& e) {
+            output << "[Caught DeltaScriptException]: " << e.message << std::endl;
+        }
+
+        return output.str();
+    }
+
+    bool read_file(const std::string& path, std::string& data) {
+        std::ifstream file(path, std::ios::binary);
+
+        if (!file) {
+            std::cerr << "Can not open " << path << std::endl;
+
+            return false;
+        }
+
+        std::stringstream buffer;
+        buffer << file.rdbuf();
+        data = buffer.str();
+
+        return true;
+    }
+
+    bool write_file(const std::string& path, const std::string& data) {
+        std::ofstream file(path, std::ios::out | std::ios::binary | std::ios::trunc);
+        file.write(data.data(), data.size());
+        file.close();
+
+        return (bool)file;
+    }
+
+    template <typename T>
+    T get(const std::string& entry, size_t offset) {
+        T value;
+        memcpy(&value, entry.data() + offset, sizeof(value));
+
+        return value;
+    }
+
+    template <typename T>
+    void set(std::string& entry, size_t offset, T value) {
+        memcpy(&entry[offset], &value, sizeof(value));
+    }
+
+    // Updates the payload size and checksum in the header after the payload was changed
+    void seal(std::string& entry) {
+        set(entry, payload_size_offset, (uint64_t)(entry.size() - header_size));
+        set(entry, payload_checksum_offset, DeltaScript::Util::hash_bytes(entry.data() + header_size, entry.size() - header_size));
+    }
+
+    // Where the parts of a chunk are in an entry
+    struct ChunkLayout {
+        size_t code_offset;
+        uint32_t code_count;
+        uint32_t atom_count;
+        uint32_t constant_count;
+        uint32_t function_count;
+        size_t lazy_offset;
+    };
+
+    // Walks the payload as ScriptCache::read does, without checking it
+    std::vector<ChunkLayout> get_chunk_layouts(const std::string& entry) {
+        size_t position = header_size;
+
+        auto skip_string = [&]() {
+            position += sizeof(uint32_t) + get<uint32_t>(entry, position);
+        };
+        auto skip_array = [&](size_t item_size) {
+            uint32_t count = get<uint32_t>(entry, position);
+            position += sizeof(uint32_t) + count * item_size;
+
+            return count;
+        };
+
+        uint32_t atom_count = get<uint32_t>(entry, position);
+        position += sizeof(uint32_t);
+
+        for (uint32_t i = 0; i < atom_count; ++i)
+            skip_string();
+
+        skip_array(sizeof(uint64_t));
+
+        std::vector<ChunkLayout> chunks(get<uint32_t>(entry, position));
+        position += sizeof(uint32_t);
+
+        for (ChunkLayout& chunk : chunks) {
+            chunk.code_offset = position + sizeof(uint32_t);
+            chunk.code_count = skip_array(sizeof(unsigned int));
+            chunk.atom_count = skip_array(sizeof(uint32_t));
+
+            chunk.constant_count = get<uint32_t>(entry, position);
+            position += sizeof(uint32_t);
+
+            for (uint32_t i = 0; i < chunk.constant_count; ++i) {
+                uint8_t kind = get<uint8_t>(entry, position);
+                position += sizeof(uint8_t);
+
+                if (kind == 2)
+                    skip_string();
+                else
+                    position += sizeof(int64_t);
+            }
+
+            chunk.function_count = skip_array(sizeof(uint32_t));
+            position += sizeof(int32_t);
+            skip_array(sizeof(uint32_t));
+            skip_string();
+
+            chunk.lazy_offset = position;
+            position += sizeof(uint8_t) + 2 * sizeof(uint64_t);
+        }
+
+        return chunks;
+    }
+
+    DeltaScript::OpCode get_op(unsigned int instruction) {
+        return (DeltaScript::OpCode)(instruction & 0xFF);
+    }
+
+    unsigned int make_instruction(DeltaScript::OpCode op, unsigned int operand) {
+        return (unsigned int)op | (operand << 8);
+    }
+
+    // Index of the first instruction of the program with op, or code_count if there is none
+    uint32_t find_op(const std::string& entry, const ChunkLayout& chunk, DeltaScript::OpCode op) {
+        uint32_t ip = 0;
+
+        while (ip < chunk.code_count && get_op(get<unsigned int>(entry, chunk.code_offset + ip * sizeof(unsigned int))) != op)
+            ++ip;
+
+        return ip;
+    }
+
+    // Replaces the operand of the first instruction with op in the program
+    bool set_operand(std::string& entry, DeltaScript::OpCode op, unsigned int operand) {
+        ChunkLayout program = get_chunk_layouts(entry)[0];
+        uint32_t ip = find_op(entry, program, op);
+
+        if (ip == program.code_count)
+            return false;
+
+        set(entry, program.code_offset + ip * sizeof(unsigned int), make_instruction(op, operand));
+        seal(entry);
+
+        return true;
+    }
+
+    struct Corruption {
+        const char* name;
+        // Returns false if the entry has nothing to corrupt this way
+        std::function<bool(std::string& entry)> apply;
+    };
+
+    const Corruption corruptions[] = {
+        { "truncated file", [](std::string& entry) {
+            entry.resize(entry.size() - 1);
+
+            return true;
+        } },
+        { "truncated payload", [](std::string& entry) {
+            entry.resize(entry.size() - 1);
+            seal(entry);
+
+            return true;
+        } },
+        { "bad checksum", [](std::string& entry) {
+            entry[header_size + (entry.size() - header_size) / 2] ^= 0x10;
+
+            return true;
+        } },
+        { "constant operand out of range", [](std::string& entry) {
+            return set_operand(entry, DeltaScript::OpCode::PUSH_CONSTANT, get_chunk_layouts(entry)[0].constant_count);
+        } },
+        { "atom operand out of range", [](std::string& entry) {
+            return set_operand(entry, DeltaScript::OpCode::LOAD, get_chunk_layouts(entry)[0].atom_count);
+        } },
+        { "function operand out of range", [](std::string& entry) {
+            return set_operand(entry, DeltaScript::OpCode::PUSH_FUNCTION, get_chunk_layouts(entry)[0].function_count);
+        } },
+        { "jump target past the end", [](std::string& entry) {
+            return set_operand(entry, DeltaScript::OpCode::JUMP, get_chunk_layouts(entry)[0].code_count);
+        } },
+        { "unknown opcode", [](std::string& entry) {
+            ChunkLayout program = get_chunk_layouts(entry)[0];
+            set(entry, program.code_offset, (unsigned int)DeltaScript::OpCode::END + 1);
+            seal(entry);
+
+            return true;
+        } },
+        { "mismatched stack depth", [](std::string& entry) {
+            // A POP in a loop body turned into a push leaves the loop two values deeper than
+            // it was entered
+            ChunkLayout program = get_chunk_layouts(entry)[0];
+
+            for (uint32_t ip = 0; ip < program.code_count; ++ip) {
+                unsigned int instruction = get<unsigned int>(entry, program.code_offset + ip * sizeof(unsigned int));
+                uint32_t target = instruction >> 8;
+
+                if (get_op(instruction) != DeltaScript::OpCode::JUMP || target >= ip)
+                    continue;
+
+                for (uint32_t i = target; i < ip; ++i) {
+                    size_t offset = program.code_offset + i * sizeof(unsigned int);
+
+                    if (get_op(get<unsigned int>(entry, offset)) == DeltaScript::OpCode::POP) {
+                        set(entry, offset, make_instruction(DeltaScript::OpCode::PUSH_NULL, 0));
+                        seal(entry);
+
+                        return true;
+                    }
+                }
+            }
+
+            return false;
+        } },
+        { "lazy program chunk", [](std::string& entry) {
+            // The program keeps no code and claims to be compiled on its first call
+            ChunkLayout program = get_chunk_layouts(entry)[0];
+            size_t code_bytes = program.code_count * sizeof(unsigned int);
+
+            set(entry, program.lazy_offset, (uint8_t)1);
+            set(entry, program.code_offset - sizeof(uint32_t), (uint32_t)0);
+            entry.erase(program.code_offset, code_bytes);
+            seal(entry);
+
+            return true;
+        } },
+        { "lazy body that has code", [](std::string& entry) {
+            std::vector<ChunkLayout> chunks = get_chunk_layouts(entry);
+
+            for (size_t i = 1; i < chunks.size(); ++i) {
+                if (get<uint8_t>(entry, chunks[i].lazy_offset) && chunks[i].code_count == 0) {
+                    // One END instruction, the body range stays as it was
+                    entry.insert(chunks[i].code_offset, std::string(sizeof(unsigned int), '\0'));
+                    set(entry, chunks[i].code_offset, make_instruction(DeltaScript::OpCode::END, 0));
+                    set(entry, chunks[i].code_offset - sizeof(uint32_t), (uint32_t)1);
+                    seal(entry);
+
+                    return true;
+                }
+            }
+
+            return false;
+        } },
+    };
+}
+
+int main(int argc, char** argv) {
+    if (argc != 3) {
+        std::cerr << "Usage: " << argv[0] << " <script.ds> <scratch directory>" << std::endl;
+
+        return 2;
+    }
+
+    std::string text;
+
+    if (!read_file(argv[1], text))
+        return 2;
+
+    std::string path = std::string(argv[2]) + "/script_cache_test.dsc";
+    std::shared_ptr<const DeltaScript::Source> source = DeltaScript::Source::from_string(text);
+    DeltaScript::Context compiler;
+    DeltaScript::Script script = compiler.compile(source);
+    std::string reference = run(script);
+
+    DeltaScript::ScriptCache::write(script, path);
+
+    std::string entry;
+
+    if (!read_file(path, entry))
+        return 2;
+
+    int result = 0;
+
+    // A new Source of the same text, as another process would have
+    std::unique_ptr<DeltaScript::Script> loaded = DeltaScript::ScriptCache::read(path, DeltaScript::Source::from_string(text));
+
+    if (!loaded) {
+        std::cerr << "The entry written for " << argv[1] << " is rejected" << std::endl;
+
+        return 1;
+    }
+
+    std::string output = run(*loaded);
+
+    if (output != reference) {
+        std::cerr << "The entry loaded for " << argv[1] << " runs differently" << std::endl
+            << "--- compiled" << std::endl << reference
+            << "--- loaded" << std::endl << output;
+
+        result = 1;
+    }
+
+    // Sealing an unchanged entry keeps it valid, so a rejection below is due to the corruption
+    std::string sealed = entry;
+    seal(sealed);
+
+    if (sealed != entry || !write_file(path, sealed) || !DeltaScript::ScriptCache::read(path, source)) {
+        std::cerr << "Sealing an unchanged entry breaks it" << std::endl;
+
+        return 1;
+    }
+
+    for (const Corruption& corruption : corruptions) {
+        std::string corrupted = entry;
+
+        if (!corruption.apply(corrupted)) {
+            std::cerr << argv[1] << " has nothing to test " << corruption.name << " on" << std::endl;
+            result = 1;
+
+            continue;
+        }
+
+        if (!write_file(path, corrupted))
+            return 2;
+
+        if (DeltaScript::ScriptCache::read(path, source)) {
+            std::cerr << "Corrupted entry accepted: " << corruption.name << std::endl;
+            result = 1;
+        }
+    }
+
+    std::remove(path.c_str());
+
+    return result;
+}
@@ -0,0 +1,761 @@
+#include <DeltaScript/DeltaScript.h>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <sstream>
+#include <vector>
+
+// Ahead-of-time compiler: translates the top-level functions of a script to C++ that runs them
+// on the Variable runtime, and registers them as native functions. The rest of the script is
+// kept as source, with the compiled declarations blanked out, and runs in the interpreter.
+//
+// Usage: deltascript-aot <script> <name> <output directory>
+// Writes <name>.h and <name>.cpp, declaring DeltaScriptAot::register_<name>(Context&) and
+// DeltaScriptAot::execute_<name>(Context&).
+//
+// A function is compiled when it only uses its parameters, its own variables and calls to other
+// compiled functions, as it can not see the scopes of its caller once it is native. Its variables
+// are declared at the top level of the body and only changed by whole statements, such as
+// "x = x + 1;" or "i++;". Calls between compiled functions are bound when the script is compiled.
+// Any other function is left to the interpreter, the tool lists them with the reason.
+
+using namespace DeltaScript;
+
+struct Function {
+    std::string name;
+    std::vector<std::string> parameters;
+    std::unique_ptr<Node> body;
+    // Range of the declaration in the source
+    size_t begin;
+    size_t end;
+    std::string symbol;
+    bool compiled;
+    std::string reason;
+};
+
+static const char* runtime_prelude = R"(    using DeltaScript::TokenKind;
+    using DeltaScript::Variable;
+
+    // Counted reference to a runtime value, assigning rebinds the name as the interpreter does
+    class Value {
+    private:
+        Variable* var_;
+
+    public:
+        Value() : var_((new Variable())->inc_ref()) {}
+        explicit Value(Variable* var) : var_(var->inc_ref()) {}
+        Value(const Value& value) : var_(value.var_->inc_ref()) {}
+        ~Value() { var_->unref(); }
+
+        Value& operator=(const Value& value) {
+            Variable* old_var = var_;
+            var_ = value.var_->inc_ref();
+            old_var->unref();
+
+            return *this;
+        }
+
+        Variable* get() const { return var_; }
+        bool is_true() const { return var_->get_bool(); }
+    };
+
+    inline Value integer(long long value) {
+        return Value(new Variable(value));
+    }
+
+    inline Value number(double value) {
+        return Value(new Variable(value));
+    }
+
+    inline Value string(const char* value, size_t length) {
+        return Value(new Variable(std::string(value, length), Variable::VariableFlags::STRING));
+    }
+
+    inline Value null() {
+        return Value(new Variable("", Variable::VariableFlags::NULL_));
+    }
+
+    inline Value binary(const Value& a, const Value& b, TokenKind operation) {
+        return Value(a.get()->execute_math_operation(b.get(), operation));
+    }
+
+    inline Value boolean(const Value& a, const Value& b, TokenKind operation) {
+        Variable a_value(a.is_true() ? 1 : 0);
+        Variable b_value(b.is_true() ? 1 : 0);
+
+        return Value(a_value.execute_math_operation(&b_value, operation));
+    }
+
+    inline Value logical_not(const Value& a) {
+        Variable zero(0);
+
+        return Value(a.get()->execute_math_operation(&zero, TokenKind::EQUAL_P));
+    }
+
+    inline Value negate(const Value& a) {
+        Variable zero(0);
+
+        return Value(zero.execute_math_operation(a.get(), TokenKind::MINUS_P));
+    }
+
+    inline Value step(const Value& a, TokenKind operation) {
+        Variable one(1);
+
+        return Value(a.get()->execute_math_operation(&one, operation));
+    }
+)";
+
+static std::string get_symbol(const std::string& prefix, size_t index, const std::string& name) {
+    std::string symbol = prefix + std::to_string(index) + "_";
+
+    for (char c : name)
+        symbol += (Util::is_alpha(c) || Util::is_digit(c)) ? c : '_';
+
+    return symbol;
+}
+
+static std::string get_string_literal(const std::string& value) {
+    std::string literal = "\"";
+
+    for (unsigned char c : value) {
+        if (c == '"' || c == '\\') {
+            literal += '\\';
+            literal += (char)c;
+        }
+        else if (c == '\n') {
+            literal += "\\n\"\n        \"";
+        }
+        else if (c < 0x20 || c >= 0x7F) {
+            char octal[8];
+            snprintf(octal, sizeof(octal), "\\%03o", c);
+            literal += octal;
+        }
+        else {
+            literal += (char)c;
+        }
+    }
+
+    return literal + "\"";
+}
+
+static const char* get_operation_name(TokenKind operation) {
+    switch (operation) {
+    case TokenKind::PLUS_P: return "PLUS_P";
+    case TokenKind::MINUS_P: return "MINUS_P";
+    case TokenKind::MUL_P: return "MUL_P";
+    case TokenKind::DIV_P: return "DIV_P";
+    case TokenKind::MOD_P: return "MOD_P";
+    case TokenKind::EQUAL_P: return "EQUAL_P";
+    case TokenKind::NEQUAL_P: return "NEQUAL_P";
+    case TokenKind::STRICT_EQUAL_P: return "STRICT_EQUAL_P";
+    case TokenKind::STRICT_NEQUAL_P: return "STRICT_NEQUAL_P";
+    case TokenKind::LT_P: return "LT_P";
+    case TokenKind::LTE_P: return "LTE_P";
+    case TokenKind::GT_P: return "GT_P";
+    case TokenKind::GTE_P: return "GTE_P";
+    case TokenKind::BIT_AND_P: return "BIT_AND_P";
+    case TokenKind::BIT_OR_P: return "BIT_OR_P";
+    case TokenKind::BIT_XOR_P: return "BIT_XOR_P";
+    default: return nullptr;
+    }
+}
+
+// Writes the C++ body of one function, throws with the reason if the function can not be compiled
+class FunctionWriter {
+private:
+    const Function& function_;
+    const std::map<std::string, const Function*>& compiled_;
+    std::ostringstream out_;
+    int indent_;
+    size_t temporary_count_;
+    std::map<std::string, std::string> locals_;
+    std::map<std::string, bool> declared_;
+
+public:
+    FunctionWriter(const Function& function, const std::map<std::string, const Function*>& compiled)
+        : function_(function), compiled_(compiled), indent_(2), temporary_count_(0) {}
+
+    std::string write() {
+        for (size_t i = 0; i < function_.parameters.size(); ++i) {
+            const std::string& name = function_.parameters[i];
+
+            if (locals_.count(name))
+                throw DeltaScriptException("repeats parameter '" + name + "'");
+
+            locals_[name] = get_symbol("l", locals_.size(), name);
+            declared_[name] = true;
+            line("Value " + locals_[name] + " = arguments.begin()[" + std::to_string(i) + "];");
+        }
+
+        collect_locals(function_.body.get());
+
+        for (auto& local : locals_) {
+            if (!declared_[local.first])
+                line("Value " + local.second + ";");
+        }
+
+        for (auto& statement : function_.body->children)
+            write_statement(statement.get(), true);
+
+        line("return Value();");
+
+        return out_.str();
+    }
+
+private:
+    void line(const std::string& text) {
+        out_ << std::string(indent_ * 4, ' ') << text << "\n";
+    }
+
+    std::string temporary() {
+        return "t" + std::to_string(temporary_count_++);
+    }
+
+    void collect_locals(const Node* node) {
+        if (node->kind == NodeKind::DECLARATION && !node->atoms.empty() && !locals_.count(node->atoms[0]->name)) {
+            locals_[node->atoms[0]->name] = get_symbol("l", locals_.size(), node->atoms[0]->name);
+            declared_[node->atoms[0]->name] = false;
+        }
+
+        for (auto& child : node->children)
+            collect_locals(child.get());
+    }
+
+    const std::string& get_local(const std::string& name) {
+        auto it = locals_.find(name);
+
+        if (it == locals_.end())
+            throw DeltaScriptException("uses '" + name + "' from outside the function");
+
+        if (!declared_[name])
+            throw DeltaScriptException("uses '" + name + "' before its declaration");
+
+        return it->second;
+    }
+
+    const std::string& get_assigned_local(const Node* node) {
+        if (node->kind != NodeKind::IDENTIFIER)
+            throw DeltaScriptException("assigns to a property or a value");
+
+        return get_local(node->atom->name);
+    }
+
+    // Writes the statements the value needs, in evaluation order, and returns an expression for
+    // the value without side effects. Locals are read where the expression is used, which
+    // matches the interpreter as long as nothing changes them within an expression.
+    std::string write_expression(const Node* node) {
+        switch (node->kind) {
+        case NodeKind::UNDEFINED:
+            return "Value()";
+
+        case NodeKind::NULL_:
+            return "null()";
+
+        case NodeKind::INTEGER:
+            if (node->integer == std::numeric_limits<long long>::min())
+                return "integer(-9223372036854775807LL - 1)";
+
+            return "integer(" + std::to_string(node->integer) + "LL)";
+
+        case NodeKind::FLOAT: {
+            if (!std::isfinite(node->number))
+                throw DeltaScriptException("uses a number literal out of range");
+
+            std::ostringstream value;
+            value << std::setprecision(std::numeric_limits<double>::max_digits10) << std::showpoint << node->number;
+
+            return "number(" + value.str() + ")";
+        }
+
+        case NodeKind::STRING:
+            return "string(" + get_string_literal(node->string) + ", " + std::to_string(node->string.size()) + ")";
+
+        case NodeKind::IDENTIFIER:
+            return get_local(node->atom->name);
+
+        case NodeKind::CALL: {
+            const Node* callee = node->children[0].get();
+
+            if (callee->kind != NodeKind::IDENTIFIER || locals_.count(callee->atom->name))
+                throw DeltaScriptException("calls a value that is not a compiled function");
+
+            auto it = compiled_.find(callee->atom->name);
+
+            if (it == compiled_.end())
+                throw DeltaScriptException("calls '" + callee->atom->name + "', which is not compiled");
+
+            if (it->second->parameters.size() != node->children.size() - 1)
+                throw DeltaScriptException("calls '" + callee->atom->name + "' with the wrong argument count");
+
+            std::string arguments;
+
+            for (size_t i = 1; i < node->children.size(); ++i)
+                arguments += (i > 1 ? ", " : " ") + write_expression(node->children[i].get());
+
+            std::string result = temporary();
+            line("Value " + result + " = " + it->second->symbol + "({" + arguments + (arguments.empty() ? "" : " ") + "});");
+
+            return result;
+        }
+
+        case NodeKind::NOT:
+        case NodeKind::NEGATE: {
+            std::string a = write_expression(node->children[0].get());
+            std::string result = temporary();
+            line("Value " + result + " = " + (node->kind == NodeKind::NOT ? "logical_not(" : "negate(") + a + ");");
+
+            return result;
+        }
+
+        case NodeKind::POSTFIX:
+            // Stepping a temporary gives back the value it had
+            if (node->children[0]->kind == NodeKind::IDENTIFIER)
+                throw DeltaScriptException("changes a variable within an expression");
+
+            return write_expression(node->children[0].get());
+
+        case NodeKind::BINARY:
+        case NodeKind::LOGIC: {
+            if (node->operation == TokenKind::AND_P || node->operation == TokenKind::OR_P) {
+                bool is_and = node->operation == TokenKind::AND_P;
+                std::string result = temporary();
+                line("Value " + result + " = " + write_expression(node->children[0].get()) + ";");
+                line(std::string("if (") + (is_and ? "" : "!") + result + ".is_true()) {");
+                ++indent_;
+
+                std::string b = write_expression(node->children[1].get());
+                line(result + " = boolean(" + result + ", " + b + ", TokenKind::" + (is_and ? "BIT_AND_P" : "BIT_OR_P") + ");");
+
+                --indent_;
+                line("}");
+
+                return result;
+            }
+
+            const char* operation = get_operation_name(node->operation);
+
+            if (!operation)
+                throw DeltaScriptException("uses " + Token::get_token_kind_as_string(node->operation));
+
+            std::string a = write_expression(node->children[0].get());
+            std::string b = write_expression(node->children[1].get());
+            std::string result = temporary();
+            line("Value " + result + " = binary(" + a + ", " + b + ", TokenKind::" + operation + ");");
+
+            return result;
+        }
+
+        case NodeKind::TERNARY: {
+            std::string condition = write_expression(node->children[0].get());
+            std::string result = temporary();
+            line("Value " + result + ";");
+            line("if (" + condition + ".is_true()) {");
+            ++indent_;
+            std::string a = write_expression(node->children[1].get());
+            line(result + " = " + a + ";");
+            --indent_;
+            line("}");
+            line("else {");
+            ++indent_;
+            std::string b = write_expression(node->children[2].get());
+            line(result + " = " + b + ";");
+            --indent_;
+            line("}");
+
+            return result;
+        }
+
+        case NodeKind::ASSIGN:
+            throw DeltaScriptException("assigns within an expression");
+
+        case NodeKind::SHIFT:
+            throw DeltaScriptException("shifts a value in place");
+
+        case NodeKind::PROPERTY:
+        case NodeKind::INDEX:
+            throw DeltaScriptException("reads a property");
+
+        case NodeKind::FUNCTION:
+            throw DeltaScriptException("creates a function");
+
+        default:
+            throw DeltaScriptException("uses an unsupported expression");
+        }
+    }
+
+    // Expression statements are where variables may change
+    void write_expression_statement(const Node* node) {
+        if (node->kind == NodeKind::ASSIGN) {
+            const std::string& local = get_assigned_local(node->children[0].get());
+            std::string value = write_expression(node->children[1].get());
+
+            if (node->operation == TokenKind::ASSIGN_P)
+                line(local + " = " + value + ";");
+            else if (node->operation == TokenKind::PLUS_EQ_P)
+                line(local + " = binary(" + local + ", " + value + ", TokenKind::PLUS_P);");
+            else if (node->operation == TokenKind::MINUS_EQ_P)
+                line(local + " = binary(" + local + ", " + value + ", TokenKind::MINUS_P);");
+            else
+                throw DeltaScriptException("uses " + Token::get_token_kind_as_string(node->operation));
+        }
+        else if (node->kind == NodeKind::POSTFIX && node->children[0]->kind == NodeKind::IDENTIFIER) {
+            const std::string& local = get_assigned_local(node->children[0].get());
+            line(local + " = step(" + local + ", TokenKind::" + (node->operation == TokenKind::INCR_P ? "PLUS_P" : "MINUS_P") + ");");
+        }
+        else {
+            write_expression(node);
+        }
+    }
+
+    void write_condition(const Node* node) {
+        std::string condition = write_expression(node);
+        line("if (!" + condition + ".is_true())");
+        line("    break;");
+    }
+
+    // Variables are only declared at the top level of the body, where the statements run in
+    // the order they are written, so a name can be checked to be declared before it is read
+    void write_statement(const Node* node, bool top_level) {
+        switch (node->kind) {
+        case NodeKind::EXPRESSION:
+            write_expression_statement(node->children[0].get());
+            break;
+
+        case NodeKind::BLOCK:
+            line("{");
+            ++indent_;
+
+            for (auto& statement : node->children)
+                write_statement(statement.get(), false);
+
+            --indent_;
+            line("}");
+            break;
+
+        case NodeKind::EMPTY:
+            break;
+
+        case NodeKind::VAR:
+            if (!top_level)
+                throw DeltaScriptException("declares a variable inside a block");
+
+            for (auto& declaration : node->children) {
+                if (declaration->atoms.size() != 1)
+                    throw DeltaScriptException("declares a property");
+
+                // The name is declared before its initializer runs
+                const std::string& name = declaration->atoms[0]->name;
+                declared_[name] = true;
+
+                if (!declaration->children.empty())
+                    line(locals_[name] + " = " + write_expression(declaration->children[0].get()) + ";");
+            }
+            break;
+
+        case NodeKind::IF: {
+            std::string condition = write_expression(node->children[0].get());
+            line("if (" + condition + ".is_true()) {");
+            ++indent_;
+            write_statement(node->children[1].get(), false);
+            --indent_;
+            line("}");
+
+            if (node->children.size() > 2) {
+                line("else {");
+                ++indent_;
+                write_statement(node->children[2].get(), false);
+                --indent_;
+                line("}");
+            }
+            break;
+        }
+
+        case NodeKind::WHILE:
+            line("for (;;) {");
+            ++indent_;
+            write_condition(node->children[0].get());
+            write_statement(node->children[1].get(), false);
+            --indent_;
+            line("}");
+            break;
+
+        case NodeKind::FOR: {
+            write_statement(node->children[0].get(), top_level);
+
+            // continue goes through the iterator, as in the interpreter
+            std::string first = temporary();
+            line("for (bool " + first + " = true;; " + first + " = false) {");
+            ++indent_;
+            line("if (!" + first + ") {");
+            ++indent_;
+            write_expression_statement(node->children[2].get());
+            --indent_;
+            line("}");
+            write_condition(node->children[1].get());
+            write_statement(node->children[3].get(), false);
+            --indent_;
+            line("}");
+            break;
+        }
+
+        case NodeKind::RETURN:
+            if (node->children.empty())
+                line("return Value();");
+            else
+                line("return " + write_expression(node->children[0].get()) + ";");
+            break;
+
+        case NodeKind::BREAK:
+            line("break;");
+            break;
+
+        case NodeKind::CONTINUE:
+            line("continue;");
+            break;
+
+        case NodeKind::FUNCTION_DECLARATION:
+            throw DeltaScriptException("declares a function");
+
+        default:
+            throw DeltaScriptException("uses an unsupported statement");
+        }
+    }
+};
+
+static bool is_valid_name(const std::string& name) {
+    if (name.empty() || Util::is_digit(name[0]))
+        return false;
+
+    for (char c : name) {
+        if (!Util::is_alpha(c) && !Util::is_digit(c) && c != '_')
+            return false;
+    }
+
+    return true;
+}
+
+static std::vector<Function> read_functions(const std::shared_ptr<const Source>& source, AtomTable& atoms) {
+    std::vector<Function> functions;
+    std::map<std::string, int> name_counts;
+
+    Lexer lex(source, &atoms);
+    Parser parser(&lex);
+    std::unique_ptr<Node> program = parser.parse_program();
+
+    for (auto& statement : program->children) {
+        if (statement->kind != NodeKind::FUNCTION_DECLARATION || !statement->atom)
+            continue;
+
+        ++name_counts[statement->atom->name];
+
+        // Bodies are not parsed until they are needed, the body range is known then
+        if (!statement->children.empty())
+            continue;
+
+        size_t body_end = (size_t)statement->end_position;
+        Lexer body_lex(source, (size_t)statement->integer, body_end, &atoms);
+        Parser body_parser(&body_lex, false);
+
+        Function function;
+        function.name = statement->atom->name;
+
+        for (const Atom* parameter : statement->atoms)
+            function.parameters.push_back(parameter->name);
+
+        function.body = body_parser.parse_block();
+        function.begin = (size_t)statement->position;
+        function.end = body_end;
+        function.symbol = get_symbol("f", functions.size(), function.name);
+        function.compiled = true;
+
+        functions.push_back(std::move(function));
+    }
+
+    for (Function& function : functions) {
+        if (name_counts[function.name] > 1) {
+            function.compiled = false;
+            function.reason = "is declared more than once";
+        }
+    }
+
+    return functions;
+}
+
+// Drops functions until every compiled function only calls compiled ones
+static void select_functions(std::vector<Function>& functions) {
+    bool changed = true;
+
+    while (changed) {
+        changed = false;
+        std::map<std::string, const Function*> compiled;
+
+        for (const Function& function : functions) {
+            if (function.compiled)
+                compiled[function.name] = &function;
+        }
+
+        for (Function& function : functions) {
+            if (!function.compiled)
+                continue;
+
+            try {
+                FunctionWriter(function, compiled).write();
+            }
+            catch (DeltaScriptException& e) {
+                function.compiled = false;
+                function.reason = e.message;
+                changed = true;
+            }
+        }
+    }
+}
+
+static void write_file(const std::string& path, const std::string& contents) {
+    std::ofstream file(path, std::ios::out | std::ios::binary | std::ios::trunc);
+
+    if (!file)
+        throw DeltaScriptException("Unable to write '" + path + "'");
+
+    file << contents;
+}
+
+int main(int argc, char** argv) {
+    if (argc != 4) {
+        std::cerr << "Usage: deltascript-aot <script> <name> <output directory>" << std::endl;
+
+        return 2;
+    }
+
+    std::string script_path = argv[1];
+    std::string name = argv[2];
+    std::string output_directory = argv[3];
+
+    if (!is_valid_name(name)) {
+        std::cerr << "deltascript-aot: '" << name << "' is not a valid C++ name" << std::endl;
+
+        return 2;
+    }
+
+    try {
+        std::shared_ptr<const Source> source = Source::from_file(script_path);
+        AtomTable atoms;
+        std::vector<Function> functions = read_functions(source, atoms);
+
+        select_functions(functions);
+
+        std::map<std::string, const Function*> compiled;
+        // 1 for characters replaced by a space, 2 for characters dropped
+        std::vector<char> removed(source->size(), 0);
+
+        for (const Function& function : functions) {
+            if (!function.compiled) {
+                std::cout << "deltascript-aot: " << function.name << " is left to the interpreter, it " << function.reason << std::endl;
+                continue;
+            }
+
+            compiled[function.name] = &function;
+
+            // Lines are kept, and the column of whatever follows on the last line
+            size_t last_line = function.begin;
+
+            for (size_t i = function.begin; i < function.end; ++i) {
+                if (Util::is_line_terminator(source->data()[i]))
+                    last_line = i + 1;
+            }
+
+            for (size_t i = function.begin; i < function.end; ++i) {
+                if (!Util::is_line_terminator(source->data()[i]))
+                    removed[i] = i < last_line ? 2 : 1;
+            }
+        }
+
+        std::string remaining_source;
+
+        for (size_t i = 0; i < source->size(); ++i) {
+            if (removed[i] == 1)
+                remaining_source += ' ';
+            else if (removed[i] == 0)
+                remaining_source += source->data()[i];
+        }
+
+        std::ostringstream header;
+        header << "// Generated by deltascript-aot from " << script_path << ", do not edit\n"
+            << "#ifndef DELTASCRIPT_AOT_" << name << "_H_\n"
+            << "#define DELTASCRIPT_AOT_" << name << "_H_\n\n"
+            << "#include <DeltaScript/DeltaScript.h>\n\n"
+            << "namespace DeltaScriptAot {\n"
+            << "    // Adds the compiled functions of the script to context as native functions\n"
+            << "    void register_" << name << "(DeltaScript::Context& context);\n"
+            << "    // Registers the functions, then runs the rest of the script on context\n"
+            << "    void execute_" << name << "(DeltaScript::Context& context);\n"
+            << "}  // namespace DeltaScriptAot\n\n"
+            << "#endif  // DELTASCRIPT_AOT_" << name << "_H_\n";
+
+        std::ostringstream code;
+        code << "// Generated by deltascript-aot from " << script_path << ", do not edit\n"
+            << "#include \"" << name << ".h\"\n"
+            << "#include <initializer_list>\n\n"
+            << "namespace {\n"
+            << runtime_prelude;
+
+        for (auto& function : compiled)
+            code << "\n    Value " << function.second->symbol << "(std::initializer_list<Value> arguments);\n";
+
+        for (auto& function : compiled) {
+            code << "\n    // function " << function.first << "\n"
+                << "    Value " << function.second->symbol << "(std::initializer_list<Value> arguments) {\n"
+                << FunctionWriter(*function.second, compiled).write()
+                << "    }\n\n"
+                << "    void call_" << function.second->symbol << "(Variable* function_root, void*) {\n"
+                << "        Value result = " << function.second->symbol << "({";
+
+            for (size_t i = 0; i < function.second->parameters.size(); ++i) {
+                code << (i ? ", " : " ") << "Value(function_root->find_child("
+                    << get_string_literal(function.second->parameters[i]) << ")->var)";
+            }
+
+            code << (function.second->parameters.empty() ? "" : " ") << "});\n"
+                << "        function_root->find_child(\"return\")->replace_with(result.get());\n"
+                << "    }\n";
+        }
+
+        code << "\n    const char remaining_source[] = " << get_string_literal(remaining_source) << ";\n"
+            << "}\n\n"
+            << "namespace DeltaScriptAot {\n"
+            << "    void register_" << name << "(DeltaScript::Context& context) {\n";
+
+        for (auto& function : compiled) {
+            std::string definition = "function " + function.first + "(";
+
+            for (size_t i = 0; i < function.second->parameters.size(); ++i)
+                definition += (i ? ", " : "") + function.second->parameters[i];
+
+            code << "        context.add_native_function(" << get_string_literal(definition + ")")
+                << ", call_" << function.second->symbol << ", nullptr);\n";
+        }
+
+        code << "    }\n\n"
+            << "    void execute_" << name << "(DeltaScript::Context& context) {\n"
+            << "        register_" << name << "(context);\n"
+            << "        context.execute(std::string(remaining_source, sizeof(remaining_source) - 1));\n"
+            << "    }\n"
+            << "}  // namespace DeltaScriptAot\n";
+
+        write_file(output_directory + "/" + name + ".h", header.str());
+        write_file(output_directory + "/" + name + ".cpp", code.str());
+
+        std::cout << "deltascript-aot: compiled " << compiled.size() << " of " << functions.size()
+            << " functions of " << script_path << std::endl;
+    }
+    catch (DeltaScriptException& e) {
+        std::cerr << "deltascript-aot: " << e.message << std::endl;
+
+        return 1;
+    }
+
+    return 0;
+}